@@ -0,0 +1,328 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <algorithm>
+#include <cctype>
+
+// Heimdall
+#include "ArchiveVerifier.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+enum
+{
+	kTarBlockSize = 512,
+
+	// Long enough for the checksum followed by the archive's filename.
+	kMaxChecksumLineLength = 4096
+};
+
+ArchiveVerifier::ArchiveVerifier(const string& filename, FILE *file, unsigned long long bodyLength, const string& expectedDigest)
+{
+	this->filename = filename;
+	this->file = file;
+	this->bodyLength = bodyLength;
+	this->expectedDigest = expectedDigest;
+
+	hashedLength = 0;
+	matches = false;
+
+	queuedSize = 0;
+
+	started = false;
+	finishing = false;
+	stopping = false;
+}
+
+ArchiveVerifier::~ArchiveVerifier()
+{
+	{
+		lock_guard<mutex> lock(chunkMutex);
+		stopping = true;
+	}
+
+	chunkCondition.notify_all();
+
+	if (hashingThread.joinable())
+		hashingThread.join();
+
+	FileClose(file);
+}
+
+ArchiveVerifier *ArchiveVerifier::Create(const string& filename)
+{
+	FILE *file = FileOpen(filename.c_str(), "rb");
+
+	if (!file)
+		return (nullptr);
+
+	FileSeek(file, 0, SEEK_END);
+	unsigned long long fileSize = (unsigned long long)FileTell(file);
+
+	// The checksum is appended as a line in the format output by md5sum, i.e. "<32 hex digits>  <filename>\n".
+	unsigned int tailLength = (fileSize < kMaxChecksumLineLength) ? (unsigned int)fileSize : (unsigned int)kMaxChecksumLineLength;
+	vector<unsigned char> tail(tailLength);
+
+	FileSeek(file, (long long)(fileSize - tailLength), SEEK_SET);
+
+	if (tailLength == 0 || fread(tail.data(), 1, tailLength, file) != tailLength)
+	{
+		FileClose(file);
+		return (nullptr);
+	}
+
+	unsigned int lineEnd = tailLength;
+
+	while (lineEnd > 0 && (tail[lineEnd - 1] == '\n' || tail[lineEnd - 1] == '\r'))
+		lineEnd--;
+
+	// The archive itself ends with zero filled blocks.
+	unsigned int lineStart = lineEnd;
+
+	while (lineStart > 0 && tail[lineStart - 1] != '\n' && tail[lineStart - 1] != '\0')
+		lineStart--;
+
+	unsigned long long bodyLength = fileSize - tailLength + lineStart;
+	string line(tail.begin() + lineStart, tail.begin() + lineEnd);
+
+	bool isChecksum = lineStart > 0 && bodyLength % kTarBlockSize == 0 && line.length() > 33 && line[32] == ' ';
+
+	for (unsigned int i = 0; isChecksum && i < 32; i++)
+		isChecksum = isxdigit((unsigned char)line[i]) != 0;
+
+	if (!isChecksum)
+	{
+		FileClose(file);
+		return (nullptr);
+	}
+
+	return (new ArchiveVerifier(filename, file, bodyLength, line.substr(0, 32)));
+}
+
+bool ArchiveVerifier::IsFed(unsigned long long offset, unsigned long long *regionEnd) const
+{
+	for (vector<pair<unsigned long long, unsigned long long>>::const_iterator it = fedRegions.begin(); it != fedRegions.end(); it++)
+	{
+		if (offset < it->first)
+		{
+			*regionEnd = it->first;
+			return (false);
+		}
+
+		if (offset < it->first + it->second)
+		{
+			*regionEnd = it->first + it->second;
+			return (true);
+		}
+	}
+
+	*regionEnd = bodyLength;
+	return (false);
+}
+
+bool ArchiveVerifier::HashFromFile(unsigned long long end)
+{
+	if (end > bodyLength)
+		end = bodyLength;
+
+	if (hashedLength >= end)
+		return (true);
+
+	vector<unsigned char> buffer(kReadSize);
+
+	FileSeek(file, (long long)hashedLength, SEEK_SET);
+
+	while (hashedLength < end)
+	{
+		{
+			lock_guard<mutex> lock(chunkMutex);
+
+			if (stopping)
+				return (false);
+		}
+
+		unsigned int readSize = (end - hashedLength < kReadSize) ? (unsigned int)(end - hashedLength) : (unsigned int)kReadSize;
+
+		if (fread(buffer.data(), 1, readSize, file) != readSize)
+		{
+			Interface::PrintError("Failed to read \"%s\" whilst verifying its checksum!\n", filename.c_str());
+			return (false);
+		}
+
+		md5.Update(buffer.data(), readSize);
+		hashedLength += readSize;
+	}
+
+	return (true);
+}
+
+bool ArchiveVerifier::HashChunk(const Chunk& chunk)
+{
+	unsigned long long chunkEnd = chunk.offset + chunk.data.size();
+
+	if (chunkEnd > bodyLength)
+		chunkEnd = bodyLength;
+
+	if (chunkEnd <= hashedLength)
+		return (true);
+
+	// Anything missed before the chunk (e.g. dropped whilst the queue was full) has to be read.
+	if (chunk.offset > hashedLength && !HashFromFile(chunk.offset))
+		return (false);
+
+	md5.Update(chunk.data.data() + (hashedLength - chunk.offset), chunkEnd - hashedLength);
+	hashedLength = chunkEnd;
+
+	return (true);
+}
+
+void ArchiveVerifier::HashArchive(void)
+{
+	bool success = true;
+
+	while (success && hashedLength < bodyLength)
+	{
+		unsigned long long regionEnd;
+
+		if (!IsFed(hashedLength, &regionEnd))
+		{
+			success = HashFromFile(regionEnd);
+			continue;
+		}
+
+		Chunk chunk;
+
+		{
+			unique_lock<mutex> lock(chunkMutex);
+
+			while (chunks.empty() && !finishing && !stopping)
+				chunkCondition.wait(lock);
+
+			if (stopping)
+				return;
+
+			if (!chunks.empty())
+			{
+				chunk = move(chunks.front());
+				chunks.pop_front();
+				queuedSize -= chunk.data.size();
+			}
+		}
+
+		// Once finishing, nothing more will be fed.
+		if (chunk.data.empty())
+			success = HashFromFile(bodyLength);
+		else
+			success = HashChunk(chunk);
+	}
+
+	if (!success)
+		return;
+
+	unsigned char digest[Md5::kDigestSize];
+	md5.GetDigest(digest);
+
+	string digestString;
+
+	for (unsigned int i = 0; i < Md5::kDigestSize; i++)
+	{
+		char hex[3];
+		sprintf(hex, "%02x", digest[i]);
+		digestString += hex;
+	}
+
+	matches = Utility::EqualsIgnoringCase(digestString, expectedDigest);
+
+	if (!matches)
+		Interface::PrintError("MD5 checksum of \"%s\" doesn't match, the archive is corrupt!\n", filename.c_str());
+}
+
+void ArchiveVerifier::Start(const vector<pair<unsigned long long, unsigned long long>>& fedRegions)
+{
+	lock_guard<mutex> lock(chunkMutex);
+
+	if (started)
+		return;
+
+	this->fedRegions = fedRegions;
+	sort(this->fedRegions.begin(), this->fedRegions.end());
+
+	started = true;
+	hashingThread = thread(&ArchiveVerifier::HashArchive, this);
+}
+
+void ArchiveVerifier::Feed(unsigned long long offset, const unsigned char *data, unsigned long long length)
+{
+	{
+		lock_guard<mutex> lock(chunkMutex);
+
+		if (!started || finishing || stopping || queuedSize + length > kMaxQueuedSize)
+			return;
+
+		// Small reads (e.g. those of an LZ4 frame's block headers) are gathered into larger chunks.
+		if (!chunks.empty())
+		{
+			Chunk& lastChunk = chunks.back();
+
+			if (lastChunk.offset + lastChunk.data.size() == offset && lastChunk.data.size() < kChunkSize)
+			{
+				lastChunk.data.insert(lastChunk.data.end(), data, data + length);
+				queuedSize += length;
+				return;
+			}
+		}
+
+		chunks.push_back(Chunk());
+		chunks.back().offset = offset;
+		chunks.back().data.assign(data, data + length);
+		queuedSize += length;
+	}
+
+	chunkCondition.notify_one();
+}
+
+bool ArchiveVerifier::Finish(void)
+{
+	{
+		lock_guard<mutex> lock(chunkMutex);
+
+		if (!started)
+		{
+			started = true;
+			hashingThread = thread(&ArchiveVerifier::HashArchive, this);
+		}
+
+		finishing = true;
+	}
+
+	chunkCondition.notify_all();
+
+	call_once(finishFlag, [this]()
+	{
+		hashingThread.join();
+	});
+
+	return (matches);
+}
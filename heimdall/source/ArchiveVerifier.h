@@ -0,0 +1,123 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef ARCHIVEVERIFIER_H
+#define ARCHIVEVERIFIER_H
+
+// C/C++ Standard Library
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Heimdall
+#include "Md5.h"
+
+namespace Heimdall
+{
+	// Verifies the MD5 checksum appended to a .tar.md5 archive on a separate thread. The thread is fed the archive's data
+	// as it's read for flashing, so the archive isn't read a second time. Only data that isn't flashed (tar headers,
+	// skipped members) or couldn't be fed in time is read by the thread itself.
+	class ArchiveVerifier
+	{
+		public:
+
+			enum
+			{
+				kReadSize = 1048576,
+				kChunkSize = 1048576,
+
+				// Data fed whilst this much is already waiting to be hashed is dropped, and read again later, rather than
+				// holding back the transfer.
+				kMaxQueuedSize = 64 * 1048576
+			};
+
+		private:
+
+			struct Chunk
+			{
+				unsigned long long offset;
+				std::vector<unsigned char> data;
+			};
+
+			std::string filename;
+			FILE *file;
+
+			// The length of the tar archive preceding the checksum, which is what the checksum covers.
+			unsigned long long bodyLength;
+			std::string expectedDigest;
+
+			// Regions of the archive (offset and length) that will be fed, sorted by offset.
+			std::vector<std::pair<unsigned long long, unsigned long long>> fedRegions;
+
+			Md5 md5;
+			unsigned long long hashedLength;
+			bool matches;
+
+			std::mutex chunkMutex;
+			std::condition_variable chunkCondition;
+			std::deque<Chunk> chunks;
+			unsigned long long queuedSize;
+
+			bool started;
+			bool finishing;
+			bool stopping;
+
+			std::thread hashingThread;
+			std::once_flag finishFlag;
+
+			ArchiveVerifier(const std::string& filename, FILE *file, unsigned long long bodyLength, const std::string& expectedDigest);
+
+			bool IsFed(unsigned long long offset, unsigned long long *regionEnd) const;
+
+			bool HashFromFile(unsigned long long end);
+			bool HashChunk(const Chunk& chunk);
+			void HashArchive(void);
+
+		public:
+
+			~ArchiveVerifier();
+
+			// Returns nullptr if the archive doesn't end with an MD5 checksum (i.e. isn't a .tar.md5 file).
+			static ArchiveVerifier *Create(const std::string& filename);
+
+			// Begins hashing, given the regions of the archive that will be fed. Only the first call has any effect, so
+			// several devices being flashed with the same archive can share a verifier.
+			void Start(const std::vector<std::pair<unsigned long long, unsigned long long>>& fedRegions);
+
+			// Hashes data read from offset within the archive. Anything already hashed is ignored, so data may be fed
+			// more than once.
+			void Feed(unsigned long long offset, const unsigned char *data, unsigned long long length);
+
+			// Hashes whatever hasn't been fed, then checks the digest against the archive's checksum.
+			bool Finish(void);
+
+			const std::string& GetFilename(void) const
+			{
+				return (filename);
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,265 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Heimdall
+#include "Arguments.h"
+#include "BatchAction.h"
+#include "BridgeManager.h"
+#include "DeviceSession.h"
+#include "Heimdall.h"
+#include "Interface.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *BatchAction::usage = "Action: batch\n\
+Arguments: <script filename> [--verbose] [--no-reboot] [--resume]\n\
+    [--stdout-errors] [--usb-log-level <none/error/warning/debug>]\n\
+    [--usb-transfer-mode <sync/async>] [--no-delay]\n\
+Description: Runs the commands in a script, one per line, within a single\n\
+    session, so the device is only initialised once and its PIT is only\n\
+    downloaded once. A script filename of - reads the script from stdin.\n\
+    Arguments containing spaces may be double quoted, and anything following\n\
+    a # is ignored. The script stops at the first command that fails.\n\
+Commands:\n\
+    print-pit\n\
+    download-pit <filename>\n\
+    flash <partition name/identifier> <filename> [<partition> <filename> ...]\n\
+    end-session [--no-reboot] (close-pc-screen is accepted as an alias)\n\
+Note: If the script doesn't end the session itself, it's ended once the script\n\
+      has finished, and --no-reboot causes the device to remain in download\n\
+      mode. If you wish to perform another action whilst remaining in download\n\
+      mode, then the following action must specify the --resume flag.\n";
+
+struct BatchCommand
+{
+	unsigned int lineNumber;
+	vector<string> arguments;
+};
+
+static bool readScript(const char *filename, vector<BatchCommand>& commands)
+{
+	bool useStdin = string(filename) == "-";
+	FILE *scriptFile = useStdin ? stdin : FileOpen(filename, "r");
+
+	if (!scriptFile)
+	{
+		Interface::PrintError("Failed to open script \"%s\"\n", filename);
+		return (false);
+	}
+
+	bool success = true;
+	unsigned int lineNumber = 0;
+	string line;
+	char buffer[512];
+
+	while (fgets(buffer, sizeof(buffer), scriptFile))
+	{
+		line += buffer;
+
+		if (line[line.length() - 1] != '\n' && !feof(scriptFile))
+			continue;
+
+		lineNumber++;
+
+		BatchCommand command;
+		command.lineNumber = lineNumber;
+
+		if (!DeviceSession::ParseCommand(line, command.arguments))
+		{
+			Interface::PrintError("Unbalanced quotes on line %u of script.\n", lineNumber);
+			success = false;
+			break;
+		}
+
+		if (!command.arguments.empty())
+		{
+			if (!DeviceSession::IsCommand(command.arguments[0]))
+			{
+				Interface::PrintError("Unknown command \"%s\" on line %u of script.\n", command.arguments[0].c_str(), lineNumber);
+				success = false;
+				break;
+			}
+
+			commands.push_back(command);
+		}
+
+		line.clear();
+	}
+
+	if (!useStdin)
+		FileClose(scriptFile);
+
+	return (success);
+}
+
+int BatchAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	if (argc < 3 || (argv[2][0] == '-' && argv[2][1] != '\0'))
+	{
+		Interface::Print("Script file was not specified.\n\n");
+		Interface::Print(BatchAction::usage);
+		return (0);
+	}
+
+	const char *scriptFilename = argv[2];
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["no-reboot"] = kArgumentTypeFlag;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["no-delay"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["usb-transfer-mode"] = kArgumentTypeString;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 3))
+	{
+		Interface::Print(BatchAction::usage);
+		return (0);
+	}
+
+	bool reboot = arguments.GetArgument("no-reboot") == nullptr;
+	bool resume = arguments.GetArgument("resume") != nullptr;
+	bool verbose = arguments.GetArgument("verbose") != nullptr;
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	if (arguments.GetArgument("no-delay") != nullptr)
+		Interface::SetNoDelay(true);
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(BatchAction::usage);
+			return (0);
+		}
+	}
+
+	const StringArgument *usbTransferModeArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-transfer-mode"));
+
+	BridgeManager::UsbTransferMode usbTransferMode = BridgeManager::UsbTransferMode::Default;
+
+	if (usbTransferModeArgument)
+	{
+		const string& usbTransferModeString = usbTransferModeArgument->GetValue();
+
+		if (usbTransferModeString.compare("sync") == 0 || usbTransferModeString.compare("SYNC") == 0)
+		{
+			usbTransferMode = BridgeManager::UsbTransferMode::Sync;
+		}
+		else if (usbTransferModeString.compare("async") == 0 || usbTransferModeString.compare("ASYNC") == 0)
+		{
+			usbTransferMode = BridgeManager::UsbTransferMode::Async;
+		}
+		else
+		{
+			Interface::Print("Unknown USB transfer mode: %s\n\n", usbTransferModeString.c_str());
+			Interface::Print(BatchAction::usage);
+			return (0);
+		}
+	}
+
+	// The whole script is read before the device is touched, so that mistakes in it don't leave a job half done.
+
+	vector<BatchCommand> commands;
+
+	if (!readScript(scriptFilename, commands))
+		return (1);
+
+	// Info
+
+	Interface::PrintReleaseInfo();
+	Interface::Pause(1000);
+
+	BridgeManager *bridgeManager = new BridgeManager(verbose);
+	bridgeManager->SetUsbLogLevel(usbLogLevel);
+	bridgeManager->SetUsbTransferMode(usbTransferMode);
+
+	DeviceSession deviceSession(bridgeManager, resume);
+
+	if (!deviceSession.Begin())
+		return (1);
+
+	bool success = true;
+
+	for (vector<BatchCommand>::const_iterator it = commands.begin(); it != commands.end(); it++)
+	{
+		if (deviceSession.HasRebooted())
+		{
+			Interface::PrintError("Line %u of script follows the end of the session.\n", it->lineNumber);
+			success = false;
+			break;
+		}
+
+		if (verbose)
+			Interface::Print("Running line %u of script: %s\n", it->lineNumber, it->arguments[0].c_str());
+
+		if (!deviceSession.RunCommand(it->arguments))
+		{
+			Interface::PrintError("Script failed at line %u.\n", it->lineNumber);
+			success = false;
+			break;
+		}
+	}
+
+	if (!deviceSession.End(reboot))
+		success = false;
+
+	return (success ? 0 : 1);
+}
@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class BeginDumpPacket : public FileTransferPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<FileTransferPacket::kDataSize, unsigned int, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		public:
 
 			enum
@@ -59,12 +65,11 @@ namespace Heimdall
 				return (chipId);
 			}
 
-			virtual void Pack(void)
+			void Pack(void)
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, chipType);
-				PackInteger(FileTransferPacket::kDataSize + 4, chipId);
+				Layout::Pack(data, chipType, chipId);
 			}
 	};
 }
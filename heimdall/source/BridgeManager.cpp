@@ -18,7 +18,8 @@
  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  THE SOFTWARE.*/
 
-// C Standard Library
+// C/C++ Standard Library
+#include <algorithm>
 #include <cstdio>
 
 // libusb
@@ -28,7 +29,9 @@
 #include "BeginDumpPacket.h"
 #include "BeginSessionPacket.h"
 #include "BridgeManager.h"
+#include "DeviceProfile.h"
 #include "DeviceTypePacket.h"
+#include "DumpFileWriter.h"
 #include "DumpPartFileTransferPacket.h"
 #include "DumpPartPitFilePacket.h"
 #include "DumpResponse.h"
@@ -36,7 +39,9 @@
 #include "EndPhoneFileTransferPacket.h"
 #include "EndPitFileTransferPacket.h"
 #include "EndSessionPacket.h"
+#include "FilePartSource.h"
 #include "FilePartSizePacket.h"
+#include "FileTransferPlan.h"
 #include "FileTransferPacket.h"
 #include "FlashPartFileTransferPacket.h"
 #include "FlashPartPitFilePacket.h"
@@ -51,6 +56,7 @@
 #include "SendFilePartResponse.h"
 #include "SessionSetupPacket.h"
 #include "SessionSetupResponse.h"
+#include "Utility.h"
 
 // Future versions of libusb will use usb_interface instead of interface.
 #ifndef usb_interface
@@ -59,6 +65,7 @@
 
 #define USB_CLASS_CDC_DATA 0x0A
 
+using namespace std;
 using namespace libpit;
 using namespace Heimdall;
 
@@ -75,30 +82,215 @@ enum
 	kFileTransferSequenceTimeoutDefault = 30000 // 30 seconds
 };
 
-int BridgeManager::FindDeviceInterface(void)
+enum
 {
-	Interface::Print("Detecting device...\n");
+	kFileTransferSequenceTimeoutLarge = 120000 // 2 minutes!
+};
+
+// File part sizes trialled when autotuning, in the order they're tried.
+static const unsigned int filePartSizeCandidates[] = { 1048576, 2097152, 524288 };
+
+struct AsyncTransferState
+{
+	int pendingCount;
+	int completed; // Set once pendingCount reaches zero, for libusb_handle_events_timeout_completed().
+	int bytesTransferred;
+	int result;
+};
+
+static void LIBUSB_CALL asyncTransferCallback(libusb_transfer *transfer)
+{
+	AsyncTransferState *state = static_cast<AsyncTransferState *>(transfer->user_data);
+
+	state->bytesTransferred += transfer->actual_length;
+
+	if (state->result == LIBUSB_SUCCESS)
+	{
+		if (transfer->status == LIBUSB_TRANSFER_TIMED_OUT)
+			state->result = LIBUSB_ERROR_TIMEOUT;
+		else if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
+			state->result = LIBUSB_ERROR_NO_DEVICE;
+		else if (transfer->status != LIBUSB_TRANSFER_COMPLETED || transfer->actual_length != transfer->length)
+			state->result = LIBUSB_ERROR_IO;
+	}
+
+	// Mark the transfer as free for reuse.
+	transfer->length = 0;
+
+	if (--state->pendingCount == 0)
+		state->completed = 1;
+}
+
+bool BridgeManager::IsSupportedDevice(libusb_device *device)
+{
+	libusb_device_descriptor descriptor;
+
+	if (libusb_get_device_descriptor(device, &descriptor) != LIBUSB_SUCCESS)
+		return (false);
+
+	for (int i = 0; i < BridgeManager::kSupportedDeviceCount; i++)
+	{
+		if (descriptor.idVendor == supportedDevices[i].vendorId && descriptor.idProduct == supportedDevices[i].productId)
+			return (true);
+	}
+
+	return (false);
+}
+
+static string formatDeviceLocation(libusb_device *device)
+{
+	char location[64];
+	int length = sprintf(location, "%d", libusb_get_bus_number(device));
+
+	uint8_t portNumbers[7];
+	int portCount = libusb_get_port_numbers(device, portNumbers, sizeof(portNumbers));
+
+	for (int i = 0; i < portCount; i++)
+		length += sprintf(location + length, (i == 0) ? ":%d" : ".%d", portNumbers[i]);
+
+	return (location);
+}
+
+bool BridgeManager::GetDeviceLocations(vector<string>& locations)
+{
+	libusb_context *context;
+	int result = libusb_init(&context);
+
+	if (result != LIBUSB_SUCCESS)
+	{
+		Interface::PrintError("Failed to initialise libusb. libusb error: %d\n", result);
+		return (false);
+	}
 
 	struct libusb_device **devices;
-	int deviceCount = libusb_get_device_list(libusbContext, &devices);
+	int deviceCount = libusb_get_device_list(context, &devices);
 
 	for (int deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
 	{
-		libusb_device_descriptor descriptor;
-		libusb_get_device_descriptor(devices[deviceIndex], &descriptor);
+		if (IsSupportedDevice(devices[deviceIndex]))
+			locations.push_back(formatDeviceLocation(devices[deviceIndex]));
+	}
 
-		for (int i = 0; i < BridgeManager::kSupportedDeviceCount; i++)
+	if (deviceCount >= 0)
+		libusb_free_device_list(devices, deviceCount);
+
+	libusb_exit(context);
+	return (true);
+}
+
+static int LIBUSB_CALL hotplugCallback(libusb_context *, libusb_device *device, libusb_hotplug_event, void *userData)
+{
+	// libusb functions that perform I/O mustn't be called from here, so arrivals are just queued.
+	static_cast<vector<string> *>(userData)->push_back(formatDeviceLocation(device));
+	return (0);
+}
+
+bool BridgeManager::WatchDevices(const function<void (const string& location)>& deviceArrived, const function<bool (void)>& keepWatching)
+{
+	libusb_context *context;
+	int result = libusb_init(&context);
+
+	if (result != LIBUSB_SUCCESS)
+	{
+		Interface::PrintError("Failed to initialise libusb. libusb error: %d\n", result);
+		return (false);
+	}
+
+	if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+	{
+		vector<string> arrivedLocations;
+		libusb_hotplug_callback_handle callbackHandles[kSupportedDeviceCount];
+
+		for (int i = 0; i < kSupportedDeviceCount; i++)
 		{
-			if (descriptor.idVendor == supportedDevices[i].vendorId && descriptor.idProduct == supportedDevices[i].productId)
+			result = libusb_hotplug_register_callback(context, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, LIBUSB_HOTPLUG_ENUMERATE,
+				supportedDevices[i].vendorId, supportedDevices[i].productId, LIBUSB_HOTPLUG_MATCH_ANY, hotplugCallback,
+				&arrivedLocations, &callbackHandles[i]);
+
+			if (result != LIBUSB_SUCCESS)
 			{
-				heimdallDevice = devices[deviceIndex];
-				libusb_ref_device(heimdallDevice);
+				Interface::PrintError("Failed to register for device notifications. libusb error: %d\n", result);
+
+				for (int j = 0; j < i; j++)
+					libusb_hotplug_deregister_callback(context, callbackHandles[j]);
+
+				libusb_exit(context);
+				return (false);
+			}
+		}
+
+		while (true)
+		{
+			for (unsigned int i = 0; i < arrivedLocations.size(); i++)
+				deviceArrived(arrivedLocations[i]);
+
+			arrivedLocations.clear();
+
+			if (!keepWatching())
 				break;
+
+			timeval timeout = { 0, 100000 };
+			libusb_handle_events_timeout_completed(context, &timeout, nullptr);
+		}
+
+		for (int i = 0; i < kSupportedDeviceCount; i++)
+			libusb_hotplug_deregister_callback(context, callbackHandles[i]);
+	}
+	else
+	{
+		// Without hotplug support (e.g. Windows), poll for devices that weren't present last time.
+		vector<string> previousLocations;
+
+		while (true)
+		{
+			vector<string> locations;
+			struct libusb_device **devices;
+			int deviceCount = libusb_get_device_list(context, &devices);
+
+			for (int deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
+			{
+				if (IsSupportedDevice(devices[deviceIndex]))
+					locations.push_back(formatDeviceLocation(devices[deviceIndex]));
 			}
+
+			if (deviceCount >= 0)
+				libusb_free_device_list(devices, deviceCount);
+
+			for (unsigned int i = 0; i < locations.size(); i++)
+			{
+				if (find(previousLocations.begin(), previousLocations.end(), locations[i]) == previousLocations.end())
+					deviceArrived(locations[i]);
+			}
+
+			previousLocations = locations;
+
+			if (!keepWatching())
+				break;
+
+			Sleep(250);
 		}
+	}
 
-		if (heimdallDevice)
+	libusb_exit(context);
+	return (true);
+}
+
+int BridgeManager::FindDeviceInterface(void)
+{
+	Interface::Print("Detecting device...\n");
+
+	struct libusb_device **devices;
+	int deviceCount = libusb_get_device_list(libusbContext, &devices);
+
+	for (int deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
+	{
+		if (IsSupportedDevice(devices[deviceIndex])
+			&& (deviceLocation.empty() || formatDeviceLocation(devices[deviceIndex]) == deviceLocation))
+		{
+			heimdallDevice = devices[deviceIndex];
+			libusb_ref_device(heimdallDevice);
 			break;
+		}
 	}
 
 	libusb_free_device_list(devices, deviceCount);
@@ -124,27 +316,37 @@ int BridgeManager::FindDeviceInterface(void)
 		return (BridgeManager::kInitialiseFailed);
 	}
 
+	unsigned char stringBuffer[128];
+	string productName;
+
+	if (libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iProduct, stringBuffer, 128) >= 0)
+		productName = (const char *)stringBuffer;
+
+	if (libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iSerialNumber, stringBuffer, 128) >= 0)
+		serialNumber = (const char *)stringBuffer;
+
+	// bcdDevice distinguishes bootloader revisions, which may well perform differently.
+	char modelIdentifier[32];
+	sprintf(modelIdentifier, "%04X-%04X-%04X", deviceDescriptor.idVendor, deviceDescriptor.idProduct, deviceDescriptor.bcdDevice);
+
+	deviceModel = modelIdentifier;
+
+	if (!productName.empty())
+		deviceModel += "-" + productName;
+
 	if (verbose)
 	{
-		unsigned char stringBuffer[128];
-
 		if (libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iManufacturer,
 			stringBuffer, 128) >= 0)
 		{
 			Interface::Print("      Manufacturer: \"%s\"\n", stringBuffer);
 		}
 
-		if (libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iProduct,
-			stringBuffer, 128) >= 0)
-		{
-			Interface::Print("           Product: \"%s\"\n", stringBuffer);
-		}
+		if (!productName.empty())
+			Interface::Print("           Product: \"%s\"\n", productName.c_str());
 
-		if (libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iSerialNumber,
-			stringBuffer, 128) >= 0)
-		{
-			Interface::Print("         Serial No: \"%s\"\n", stringBuffer);
-		}
+		if (!serialNumber.empty())
+			Interface::Print("         Serial No: \"%s\"\n", serialNumber.c_str());
 
 		Interface::Print("\n            length: %d\n", deviceDescriptor.bLength);
 		Interface::Print("      device class: %d\n", deviceDescriptor.bDeviceClass);
@@ -366,7 +568,16 @@ BridgeManager::BridgeManager(bool verbose)
 	fileTransferPacketSize = kFileTransferPacketSizeDefault;
 	fileTransferSequenceTimeout = kFileTransferSequenceTimeoutDefault;
 
+	autotune = false;
+	emptyTransferCalibration = false;
+	emptyTransfersRequired = true;
+	deviceProfile = nullptr;
+	sequenceLengthTuner = SequenceLengthTuner(fileTransferSequenceMaxLength);
+
 	usbLogLevel = UsbLogLevel::Default;
+	usbTransferMode = UsbTransferMode::Default;
+
+	firstByteTime = 0;
 }
 
 BridgeManager::~BridgeManager()
@@ -382,6 +593,8 @@ BridgeManager::~BridgeManager()
 
 	if (libusbContext)
 		libusb_exit(libusbContext);
+
+	delete deviceProfile;
 }
 
 bool BridgeManager::DetectDevice(void)
@@ -523,45 +736,218 @@ bool BridgeManager::BeginSession(void)
 	unsigned int deviceDefaultPacketSize = beginSessionResponse.GetResult();
 
 	Interface::Print("\nSome devices may take up to 2 minutes to respond.\nPlease be patient!\n\n");
-	Sleep(3000); // Give the user time to read the message.
+	Interface::Pause(3000); // Give the user time to read the message.
+
+	if (autotune || emptyTransferCalibration)
+	{
+		deviceProfile = new DeviceProfile(deviceModel);
+		deviceProfile->Load();
+	}
 
 	if (deviceDefaultPacketSize != 0) // 0 means changing the packet size is not supported.
 	{
-		fileTransferSequenceTimeout = 120000; // 2 minutes!
-		fileTransferPacketSize = 1048576; // 1 MiB
-		fileTransferSequenceMaxLength = 30; // Therefore, fileTransferPacketSize * fileTransferSequenceMaxLength == 30 MiB per sequence.
+		fileTransferSequenceTimeout = kFileTransferSequenceTimeoutLarge;
 
-		FilePartSizePacket filePartSizePacket(fileTransferPacketSize);
+		unsigned int filePartSize = (autotune) ? ChooseFilePartSize() : (unsigned int)kFilePartSizeDefault;
+		bool rejected;
 
-		if (!SendPacket(&filePartSizePacket))
-		{
-			Interface::PrintError("Failed to send file part size packet!\n");
+		if (!SetFilePartSize(filePartSize, &rejected))
 			return (false);
+
+		if (rejected)
+		{
+			if (filePartSize == kFilePartSizeDefault)
+				return (false);
+
+			if (verbose)
+				Interface::Print("File part size of %u bytes is not supported, using the default.\n", filePartSize);
+
+			deviceProfile->SetUnsignedInt("partSize." + to_string(filePartSize) + ".unsupported", 1);
+			deviceProfile->Save();
+
+			if (!SetFilePartSize(kFilePartSizeDefault, &rejected) || rejected)
+				return (false);
 		}
 
-		SessionSetupResponse filePartSizeResponse;
+		// Therefore, fileTransferPacketSize * fileTransferSequenceMaxLength == 30 MiB per sequence.
+		fileTransferSequenceMaxLength = kFileTransferSequenceMaxBytes / fileTransferPacketSize;
+	}
 
-		if (!ReceivePacket(&filePartSizeResponse))
-			return (false);
+	if (autotune)
+	{
+		string sequenceLengthKey = "partSize." + to_string(fileTransferPacketSize) + ".sequenceLength";
 
-		if (filePartSizeResponse.GetResult() != 0)
+		if (deviceProfile->HasValue(sequenceLengthKey))
+			sequenceLengthTuner = SequenceLengthTuner(deviceProfile->GetUnsignedInt(sequenceLengthKey, fileTransferSequenceMaxLength));
+		else
+			sequenceLengthTuner = SequenceLengthTuner::CreateAutotuning(fileTransferSequenceMaxLength);
+
+		if (verbose)
 		{
-			Interface::PrintError("Unexpected file part size response!\nExpected: 0\nReceived: %d\n", filePartSizeResponse.GetResult());
-			return (false);
+			Interface::Print("Autotune: %u byte file parts, %s sequence length %u\n", fileTransferPacketSize,
+				sequenceLengthTuner.IsTuned() ? "tuned" : "trialling", sequenceLengthTuner.GetSequenceLength());
 		}
 	}
+	else
+	{
+		sequenceLengthTuner = SequenceLengthTuner(fileTransferSequenceMaxLength);
+	}
+
+	if (emptyTransferCalibration && !CalibrateEmptyTransfers())
+		return (false);
 
 	Interface::Print("Session begun.\n\n");
 	return (true);
 }
 
+// Only a control packet is probed. File parts are assumed to behave the same, so should a packet later fail whilst
+// empty transfers are being skipped, the stored result is forgotten and the next calibration probes again.
+bool BridgeManager::CalibrateEmptyTransfers(void)
+{
+	if (deviceProfile->HasValue("emptyTransfersRequired"))
+	{
+		emptyTransfersRequired = deviceProfile->GetUnsignedInt("emptyTransfersRequired") != 0;
+	}
+	else
+	{
+		// Send a harmless request without the usual trailing empty transfer. Bootloaders that depend on empty transfers
+		// won't respond until they receive one.
+		DeviceTypePacket deviceTypePacket;
+
+		if (!SendPacket(&deviceTypePacket, kDefaultTimeoutSend, kEmptyTransferNone))
+		{
+			Interface::PrintError("Failed to send empty transfer calibration packet!\n");
+			return (false);
+		}
+
+		SessionSetupResponse deviceTypeResponse;
+
+		if (ReceivePacket(&deviceTypeResponse, kTimeoutEmptyTransferCalibration, kEmptyTransferNone, false))
+		{
+			emptyTransfersRequired = false;
+		}
+		else
+		{
+			emptyTransfersRequired = true;
+
+			if (!SendBulkTransfer(nullptr, 0, kDefaultTimeoutEmptyTransfer, false) || !ReceivePacket(&deviceTypeResponse))
+			{
+				Interface::PrintError("Failed to receive empty transfer calibration response!\n");
+				return (false);
+			}
+		}
+
+		deviceProfile->SetUnsignedInt("emptyTransfersRequired", (emptyTransfersRequired) ? 1 : 0);
+
+		if (!deviceProfile->Save() && verbose)
+			Interface::PrintWarning("Failed to save device profile.\n");
+	}
+
+	if (verbose)
+		Interface::Print("Empty transfers are %s.\n", (emptyTransfersRequired) ? "required" : "not required and will be skipped");
+
+	return (true);
+}
+
+void BridgeManager::ForgetEmptyTransferCalibration(void) const
+{
+	if (emptyTransfersRequired || !deviceProfile || !deviceProfile->HasValue("emptyTransfersRequired"))
+		return;
+
+	Interface::PrintWarning("Transfer failed whilst skipping empty transfers. They'll be checked again next time.\n");
+
+	deviceProfile->RemoveValue("emptyTransfersRequired");
+
+	if (!deviceProfile->Save() && verbose)
+		Interface::PrintWarning("Failed to save device profile.\n");
+}
+
+unsigned int BridgeManager::ChooseFilePartSize(void) const
+{
+	unsigned int bestFilePartSize = kFilePartSizeDefault;
+	unsigned int bestThroughput = 0;
+
+	for (unsigned int i = 0; i < sizeof(filePartSizeCandidates) / sizeof(filePartSizeCandidates[0]); i++)
+	{
+		string key = "partSize." + to_string(filePartSizeCandidates[i]);
+
+		if (deviceProfile->HasValue(key + ".unsupported"))
+			continue;
+
+		// Try each part size once before settling on the best.
+		if (!deviceProfile->HasValue(key + ".throughput"))
+			return (filePartSizeCandidates[i]);
+
+		unsigned int throughput = deviceProfile->GetUnsignedInt(key + ".throughput");
+
+		if (throughput > bestThroughput)
+		{
+			bestFilePartSize = filePartSizeCandidates[i];
+			bestThroughput = throughput;
+		}
+	}
+
+	return (bestFilePartSize);
+}
+
+bool BridgeManager::SetFilePartSize(unsigned int filePartSize, bool *rejected)
+{
+	*rejected = false;
+
+	FilePartSizePacket filePartSizePacket(filePartSize);
+
+	if (!SendPacket(&filePartSizePacket))
+	{
+		Interface::PrintError("Failed to send file part size packet!\n");
+		return (false);
+	}
+
+	SessionSetupResponse filePartSizeResponse;
+
+	if (!ReceivePacket(&filePartSizeResponse))
+		return (false);
+
+	if (filePartSizeResponse.GetResult() != 0)
+	{
+		if (filePartSize == kFilePartSizeDefault || !autotune)
+			Interface::PrintError("Unexpected file part size response!\nExpected: 0\nReceived: %d\n", filePartSizeResponse.GetResult());
+
+		*rejected = true;
+		return (true);
+	}
+
+	fileTransferPacketSize = filePartSize;
+	return (true);
+}
+
+void BridgeManager::UpdateDeviceProfile(void)
+{
+	if (!sequenceLengthTuner.IsTuned())
+		return;
+
+	string key = "partSize." + to_string(fileTransferPacketSize);
+	unsigned int throughput = sequenceLengthTuner.GetThroughput();
+
+	if (throughput == 0)
+		return;
+
+	// Smooth out the noise of individual sessions.
+	if (deviceProfile->HasValue(key + ".throughput"))
+		throughput = (throughput + deviceProfile->GetUnsignedInt(key + ".throughput")) / 2;
+
+	deviceProfile->SetUnsignedInt(key + ".throughput", throughput);
+	deviceProfile->SetUnsignedInt(key + ".sequenceLength", sequenceLengthTuner.GetSequenceLength());
+
+	if (!deviceProfile->Save() && verbose)
+		Interface::PrintWarning("Failed to save device profile.\n");
+}
+
 bool BridgeManager::EndSession(bool reboot) const
 {
 	Interface::Print("Ending session...\n");
 
-	EndSessionPacket *endSessionPacket = new EndSessionPacket(EndSessionPacket::kRequestEndSession);
-	bool success = SendPacket(endSessionPacket);
-	delete endSessionPacket;
+	EndSessionPacket endSessionPacket(EndSessionPacket::kRequestEndSession);
+	bool success = SendPacket(&endSessionPacket);
 
 	if (!success)
 	{
@@ -570,9 +956,8 @@ bool BridgeManager::EndSession(bool reboot) const
 		return (false);
 	}
 
-	ResponsePacket *endSessionResponse = new ResponsePacket(ResponsePacket::kResponseTypeEndSession);
-	success = ReceivePacket(endSessionResponse);
-	delete endSessionResponse;
+	ResponsePacket endSessionResponse(ResponsePacket::kResponseTypeEndSession);
+	success = ReceivePacket(&endSessionResponse);
 
 	if (!success)
 	{
@@ -585,9 +970,8 @@ bool BridgeManager::EndSession(bool reboot) const
 	{
 		Interface::Print("Rebooting device...\n");
 
-		EndSessionPacket *rebootDevicePacket = new EndSessionPacket(EndSessionPacket::kRequestRebootDevice);
-		bool success = SendPacket(rebootDevicePacket);
-		delete rebootDevicePacket;
+		EndSessionPacket rebootDevicePacket(EndSessionPacket::kRequestRebootDevice);
+		bool success = SendPacket(&rebootDevicePacket);
 
 		if (!success)
 		{
@@ -596,9 +980,8 @@ bool BridgeManager::EndSession(bool reboot) const
 			return (false);
 		}
 
-		ResponsePacket *rebootDeviceResponse = new ResponsePacket(ResponsePacket::kResponseTypeEndSession);
-		success = ReceivePacket(rebootDeviceResponse);
-		delete rebootDeviceResponse;
+		ResponsePacket rebootDeviceResponse(ResponsePacket::kResponseTypeEndSession);
+		success = ReceivePacket(&rebootDeviceResponse);
 
 		if (!success)
 		{
@@ -611,10 +994,109 @@ bool BridgeManager::EndSession(bool reboot) const
 	return (true);
 }
 
+int BridgeManager::SendBulkTransferAsync(unsigned char *data, int length, int timeout, int *dataTransferred) const
+{
+	// Split the data into chunks and keep several of them queued, so the host controller always has another
+	// transfer ready rather than idling whilst we wait for each blocking call to return.
+
+	libusb_transfer *transfers[kAsyncTransferCount];
+
+	for (int i = 0; i < kAsyncTransferCount; i++)
+	{
+		transfers[i] = libusb_alloc_transfer(0);
+
+		if (!transfers[i])
+		{
+			for (int j = 0; j < i; j++)
+				libusb_free_transfer(transfers[j]);
+
+			return (LIBUSB_ERROR_NO_MEM);
+		}
+
+		transfers[i]->length = 0;
+	}
+
+	AsyncTransferState state;
+	state.pendingCount = 0;
+	state.completed = 0;
+	state.bytesTransferred = 0;
+	state.result = LIBUSB_SUCCESS;
+
+	int offset = 0;
+
+	while (state.result == LIBUSB_SUCCESS && (offset < length || state.pendingCount > 0))
+	{
+		for (int i = 0; i < kAsyncTransferCount && offset < length && state.result == LIBUSB_SUCCESS; i++)
+		{
+			if (transfers[i]->length != 0)
+				continue;
+
+			int chunkLength = (length - offset < kAsyncTransferChunkSize) ? length - offset : kAsyncTransferChunkSize;
+
+			libusb_fill_bulk_transfer(transfers[i], deviceHandle, outEndpoint, data + offset, chunkLength,
+				asyncTransferCallback, &state, timeout);
+
+			int result = libusb_submit_transfer(transfers[i]);
+
+			if (result != LIBUSB_SUCCESS)
+			{
+				transfers[i]->length = 0;
+				state.result = result;
+				break;
+			}
+
+			offset += chunkLength;
+			state.pendingCount++;
+			state.completed = 0;
+		}
+
+		if (state.pendingCount > 0)
+		{
+			timeval eventTimeout;
+			eventTimeout.tv_sec = 1;
+			eventTimeout.tv_usec = 0;
+
+			libusb_handle_events_timeout_completed(libusbContext, &eventTimeout, &state.completed);
+		}
+	}
+
+	if (state.pendingCount > 0)
+	{
+		// Something failed, cancel and reap whatever is still queued.
+		for (int i = 0; i < kAsyncTransferCount; i++)
+		{
+			if (transfers[i]->length != 0)
+				libusb_cancel_transfer(transfers[i]);
+		}
+
+		while (state.pendingCount > 0)
+			libusb_handle_events_completed(libusbContext, &state.completed);
+	}
+
+	for (int i = 0; i < kAsyncTransferCount; i++)
+		libusb_free_transfer(transfers[i]);
+
+	*dataTransferred = state.bytesTransferred;
+	return (state.result);
+}
+
 bool BridgeManager::SendBulkTransfer(unsigned char *data, int length, int timeout, bool retry) const
 {
 	int dataTransferred;
-	int result = libusb_bulk_transfer(deviceHandle, outEndpoint, data, length, &dataTransferred, timeout);
+	int result;
+
+	if (usbTransferMode == UsbTransferMode::Async && length > kAsyncTransferChunkSize)
+	{
+		result = SendBulkTransferAsync(data, length, timeout, &dataTransferred);
+
+		// Retries fall back to blocking transfers.
+		if (result != LIBUSB_SUCCESS && verbose)
+			Interface::PrintError("libusb error %d whilst sending asynchronous bulk transfer.\n", result);
+	}
+	else
+	{
+		result = libusb_bulk_transfer(deviceHandle, outEndpoint, data, length, &dataTransferred, timeout);
+	}
 
 	if (result != LIBUSB_SUCCESS && retry)
 	{
@@ -650,10 +1132,12 @@ bool BridgeManager::SendBulkTransfer(unsigned char *data, int length, int timeou
 
 int BridgeManager::ReceiveBulkTransfer(unsigned char *data, int length, int timeout, bool retry) const
 {
+	// HACK: It seems WinUSB ignores us when we try to read with length zero. This is on the stack, rather than static, so
+	// that several devices may be handled at once.
+	unsigned char dummyData;
+
 	if (data == nullptr)
 	{
-		// HACK: It seems WinUSB ignores us when we try to read with length zero.
-		static unsigned char dummyData;
 		data = &dummyData;
 		length = 1;
 	}
@@ -696,9 +1180,10 @@ int BridgeManager::ReceiveBulkTransfer(unsigned char *data, int length, int time
 	return (dataTransferred);
 }
 
-bool BridgeManager::SendPacket(OutboundPacket *packet, int timeout, int emptyTransferFlags) const
+bool BridgeManager::SendPacketData(OutboundPacket *packet, int timeout, int emptyTransferFlags) const
 {
-	packet->Pack();
+	if (!emptyTransfersRequired)
+		emptyTransferFlags = kEmptyTransferNone;
 
 	if (emptyTransferFlags & kEmptyTransferBefore)
 	{
@@ -709,7 +1194,10 @@ bool BridgeManager::SendPacket(OutboundPacket *packet, int timeout, int emptyTra
 	}
 
 	if (!SendBulkTransfer(packet->GetData(), packet->GetSize(), timeout))
+	{
+		ForgetEmptyTransferCalibration();
 		return (false);
+	}
 
 	if (emptyTransferFlags & kEmptyTransferAfter)
 	{
@@ -722,7 +1210,7 @@ bool BridgeManager::SendPacket(OutboundPacket *packet, int timeout, int emptyTra
 	return (true);
 }
 
-bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, int emptyTransferFlags) const
+bool BridgeManager::ReceivePacketData(InboundPacket *packet, int timeout, int emptyTransferFlags, bool retry) const
 {
 	if (emptyTransferFlags & kEmptyTransferBefore)
 	{
@@ -732,10 +1220,13 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, int emptyT
 		}
 	}
 
-	int receivedSize = ReceiveBulkTransfer(packet->GetData(), packet->GetSize(), timeout);
+	int receivedSize = ReceiveBulkTransfer(packet->GetData(), packet->GetSize(), timeout, retry);
 
 	if (receivedSize < 0)
+	{
+		ForgetEmptyTransferCalibration();
 		return (false);
+	}
 
 	if (receivedSize != packet->GetSize() && !packet->IsSizeVariable())
 	{
@@ -747,11 +1238,6 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, int emptyT
 
 	packet->SetReceivedSize(receivedSize);
 
-	bool unpacked = packet->Unpack();
-
-	if (!unpacked && verbose)
-		Interface::PrintError("Failed to unpack received packet.\n");
-
 	if (emptyTransferFlags & kEmptyTransferAfter)
 	{
 		if (ReceiveBulkTransfer(nullptr, 0, kDefaultTimeoutEmptyTransfer, false) < 0 && verbose)
@@ -760,7 +1246,7 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, int emptyT
 		}
 	}
 
-	return (unpacked);
+	return (true);
 }
 
 bool BridgeManager::RequestDeviceType(unsigned int request, int *result) const
@@ -793,9 +1279,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	unsigned int pitBufferSize = pitData->GetPaddedSize();
 
 	// Start file transfer
-	PitFilePacket *pitFilePacket = new PitFilePacket(PitFilePacket::kRequestFlash);
-	bool success = SendPacket(pitFilePacket);
-	delete pitFilePacket;
+	PitFilePacket pitFilePacket(PitFilePacket::kRequestFlash);
+	bool success = SendPacket(&pitFilePacket);
 
 	if (!success)
 	{
@@ -803,9 +1288,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	PitFileResponse *pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse pitFileResponse;
+	success = ReceivePacket(&pitFileResponse);
 
 	if (!success)
 	{
@@ -814,9 +1298,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	}
 
 	// Transfer file size
-	FlashPartPitFilePacket *flashPartPitFilePacket = new FlashPartPitFilePacket(pitBufferSize);
-	success = SendPacket(flashPartPitFilePacket);
-	delete flashPartPitFilePacket;
+	FlashPartPitFilePacket flashPartPitFilePacket(pitBufferSize);
+	success = SendPacket(&flashPartPitFilePacket);
 
 	if (!success)
 	{
@@ -824,9 +1307,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse flashPartPitFileResponse;
+	success = ReceivePacket(&flashPartPitFileResponse);
 
 	if (!success)
 	{
@@ -842,9 +1324,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	pitData->Pack(pitBuffer);
 
 	// Flash pit file
-	SendFilePartPacket *sendFilePartPacket = new SendFilePartPacket(pitBuffer, pitBufferSize);
-	success = SendPacket(sendFilePartPacket);
-	delete sendFilePartPacket;
+	SendFilePartPacket sendFilePartPacket(pitBuffer, pitBufferSize);
+	success = SendPacket(&sendFilePartPacket);
 
 	delete [] pitBuffer;
 
@@ -854,9 +1335,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse sendFilePartResponse;
+	success = ReceivePacket(&sendFilePartResponse);
 
 	if (!success)
 	{
@@ -865,9 +1345,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	}
 
 	// End pit file transfer
-	EndPitFileTransferPacket *endPitFileTransferPacket = new EndPitFileTransferPacket(pitBufferSize);
-	success = SendPacket(endPitFileTransferPacket);
-	delete endPitFileTransferPacket;
+	EndPitFileTransferPacket endPitFileTransferPacket(pitBufferSize);
+	success = SendPacket(&endPitFileTransferPacket);
 
 	if (!success)
 	{
@@ -875,9 +1354,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse endPitFileTransferResponse;
+	success = ReceivePacket(&endPitFileTransferResponse);
 
 	if (!success)
 	{
@@ -895,9 +1373,8 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
 	bool success;
 
 	// Start file transfer
-	PitFilePacket *pitFilePacket = new PitFilePacket(PitFilePacket::kRequestDump);
-	success = SendPacket(pitFilePacket);
-	delete pitFilePacket;
+	PitFilePacket pitFilePacket(PitFilePacket::kRequestDump);
+	success = SendPacket(&pitFilePacket);
 
 	if (!success)
 	{
@@ -905,10 +1382,9 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
 		return (0);
 	}
 
-	PitFileResponse *pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	unsigned int fileSize = pitFileResponse->GetFileSize();
-	delete pitFileResponse;
+	PitFileResponse pitFileResponse;
+	success = ReceivePacket(&pitFileResponse);
+	unsigned int fileSize = pitFileResponse.GetFileSize();
 
 	if (!success)
 	{
@@ -916,50 +1392,63 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
 		return (0);
 	}
 
+	unsigned long long startTime = Utility::GetMilliseconds();
+
 	unsigned int transferCount = fileSize / ReceiveFilePartPacket::kDataSize;
 	if (fileSize % ReceiveFilePartPacket::kDataSize != 0)
 		transferCount++;
 
-	unsigned char *buffer = new unsigned char[fileSize];
-	int offset = 0;
+	// Parts are received in place. The buffer is rounded up to a whole number of parts so that a device padding the
+	// final part can't overrun it.
+	unsigned int bufferSize = transferCount * ReceiveFilePartPacket::kDataSize;
+	unsigned char *buffer = new unsigned char[bufferSize];
+	unsigned int offset = 0;
+	unsigned int requestCount = 0;
 
-	for (unsigned int i = 0; i < transferCount; i++)
+	while (offset < fileSize)
 	{
-		DumpPartPitFilePacket *requestPacket = new DumpPartPitFilePacket(i);
-		success = SendPacket(requestPacket);
-		delete requestPacket;
+		// Parts are requested by index, so a device that returns several parts in response to one request simply has
+		// us skip ahead.
+		unsigned int partIndex = offset / ReceiveFilePartPacket::kDataSize;
+
+		DumpPartPitFilePacket requestPacket(partIndex);
+		success = SendPacket(&requestPacket);
 
 		if (!success)
 		{
-			Interface::PrintError("Failed to request PIT file part #%d!\n", i);
+			Interface::PrintError("Failed to request PIT file part #%u!\n", partIndex);
 			delete [] buffer;
 			return (0);
 		}
 
-		int receiveEmptyTransferFlags = (i == transferCount - 1) ? kEmptyTransferAfter : kEmptyTransferNone;
-		
-		ReceiveFilePartPacket *receiveFilePartPacket = new ReceiveFilePartPacket();
-		success = ReceivePacket(receiveFilePartPacket, kDefaultTimeoutReceive, receiveEmptyTransferFlags);
+		requestCount++;
+
+		ReceiveFilePartPacket receiveFilePartPacket(buffer + offset, bufferSize - offset);
+		success = ReceivePacket(&receiveFilePartPacket, kDefaultTimeoutReceive, kEmptyTransferNone);
+
+		if (success)
+		{
+			unsigned int receivedSize = receiveFilePartPacket.GetReceivedSize();
+			offset += receivedSize;
+
+			if (receivedSize == 0 || (offset < fileSize && receivedSize % ReceiveFilePartPacket::kDataSize != 0))
+				success = false;
+		}
 
 		if (!success)
 		{
-			Interface::PrintError("Failed to receive PIT file part #%d!\n", i);
-			delete receiveFilePartPacket;
+			Interface::PrintError("Failed to receive PIT file part #%u!\n", partIndex);
 			delete [] buffer;
 			return (0);
 		}
-
-		// Copy the whole packet data into the buffer.
-		memcpy(buffer + offset, receiveFilePartPacket->GetData(), receiveFilePartPacket->GetReceivedSize());
-		offset += receiveFilePartPacket->GetReceivedSize();
-
-		delete receiveFilePartPacket;
 	}
 
+	if (ReceiveBulkTransfer(nullptr, 0, kDefaultTimeoutEmptyTransfer, false) < 0 && verbose)
+		Interface::PrintWarning("Empty bulk transfer after receiving packet failed. Continuing anyway...\n");
+
 	// End file transfer
-	pitFilePacket = new PitFilePacket(PitFilePacket::kRequestEndTransfer);
-	success = SendPacket(pitFilePacket);
-	delete pitFilePacket;
+	PitFilePacket endPitFileTransferPacket(PitFilePacket::kRequestEndTransfer);
+	success = SendPacket(&endPitFileTransferPacket);
 
 	if (!success)
 	{
@@ -968,9 +1457,8 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
 		return (0);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse endPitFileTransferResponse;
+	success = ReceivePacket(&endPitFileTransferResponse);
 
 	if (!success)
 	{
@@ -979,6 +1467,12 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
 		return (0);
 	}
 
+	if (verbose)
+	{
+		Interface::Print("Received %u byte PIT file in %u requests (%u expected at %d bytes each) in %llu ms.\n", fileSize,
+			requestCount, transferCount, ReceiveFilePartPacket::kDataSize, Utility::GetMilliseconds() - startTime);
+	}
+
 	*pitBuffer = buffer;
 	return (fileSize);
 }
@@ -999,7 +1493,123 @@ int BridgeManager::DownloadPitFile(unsigned char **pitBuffer) const
 	return (devicePitFileSize);
 }
 
-bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int deviceType, unsigned int fileIdentifier) const
+bool BridgeManager::VerifyPitFile(const unsigned char *pitBuffer, unsigned int pitFileSize, bool *matches) const
+{
+	*matches = false;
+
+	PitFilePacket pitFilePacket(PitFilePacket::kRequestDump);
+	bool success = SendPacket(&pitFilePacket);
+
+	if (!success)
+	{
+		Interface::PrintWarning("Failed to request receival of PIT file!\n");
+		return (false);
+	}
+
+	PitFileResponse pitFileResponse;
+	success = ReceivePacket(&pitFileResponse);
+
+	if (!success)
+	{
+		Interface::PrintWarning("Failed to receive PIT file size!\n");
+		return (false);
+	}
+
+	unsigned int fileSize = pitFileResponse.GetFileSize();
+
+	if (fileSize == pitFileSize && fileSize > 0)
+	{
+		// Only the first part (the header and first entries) and one other part are compared, so that a hit costs far
+		// fewer round trips than a download. The other part is chosen afresh each time, so repeated flashes sample the
+		// whole PIT. As in ReceivePitFile(), parts are received into a buffer rounded up to a whole number of parts, as
+		// a device may return several parts per request.
+		unsigned int transferCount = (fileSize + ReceiveFilePartPacket::kDataSize - 1) / ReceiveFilePartPacket::kDataSize;
+		unsigned int bufferSize = transferCount * ReceiveFilePartPacket::kDataSize;
+		unsigned char *buffer = new unsigned char[bufferSize];
+
+		unsigned int sampledParts[2] = { 0, 0 };
+		unsigned int sampledPartCount = 1;
+
+		if (transferCount > 1)
+			sampledParts[sampledPartCount++] = 1 + (unsigned int)(Utility::GetMilliseconds() % (transferCount - 1));
+
+		unsigned int receivedEnd = 0;
+
+		*matches = true;
+
+		for (unsigned int i = 0; i < sampledPartCount && *matches; i++)
+		{
+			unsigned int partIndex = sampledParts[i];
+			unsigned int offset = partIndex * ReceiveFilePartPacket::kDataSize;
+
+			// Already received along with an earlier part.
+			if (offset < receivedEnd)
+				continue;
+
+			DumpPartPitFilePacket requestPacket(partIndex);
+			success = SendPacket(&requestPacket);
+
+			if (!success)
+			{
+				Interface::PrintWarning("Failed to request PIT file part #%u!\n", partIndex);
+				delete [] buffer;
+				*matches = false;
+				return (false);
+			}
+
+			ReceiveFilePartPacket receiveFilePartPacket(buffer + offset, bufferSize - offset);
+			success = ReceivePacket(&receiveFilePartPacket, kDefaultTimeoutReceive, kEmptyTransferNone);
+
+			unsigned int receivedSize = receiveFilePartPacket.GetReceivedSize();
+
+			if (success && (receivedSize == 0 || (offset + receivedSize < fileSize && receivedSize % ReceiveFilePartPacket::kDataSize != 0)))
+				success = false;
+
+			if (!success)
+			{
+				Interface::PrintWarning("Failed to receive PIT file part #%u!\n", partIndex);
+				delete [] buffer;
+				*matches = false;
+				return (false);
+			}
+
+			// A device may pad the final part.
+			unsigned int compareSize = (receivedSize < fileSize - offset) ? receivedSize : fileSize - offset;
+
+			*matches = memcmp(buffer + offset, pitBuffer + offset, compareSize) == 0;
+			receivedEnd = offset + receivedSize;
+		}
+
+		delete [] buffer;
+
+		if (ReceiveBulkTransfer(nullptr, 0, kDefaultTimeoutEmptyTransfer, false) < 0 && verbose)
+			Interface::PrintWarning("Empty bulk transfer after receiving packet failed. Continuing anyway...\n");
+	}
+
+	PitFilePacket endPitFileTransferPacket(PitFilePacket::kRequestEndTransfer);
+	success = SendPacket(&endPitFileTransferPacket);
+
+	if (!success)
+	{
+		Interface::PrintWarning("Failed to send request to end PIT file transfer!\n");
+		*matches = false;
+		return (false);
+	}
+
+	PitFileResponse endPitFileTransferResponse;
+	success = ReceivePacket(&endPitFileTransferResponse);
+
+	if (!success)
+	{
+		Interface::PrintWarning("Failed to receive end PIT file transfer verification!\n");
+		*matches = false;
+		return (false);
+	}
+
+	return (true);
+}
+
+bool BridgeManager::SendFile(FilePartSource *fileSource, unsigned int destination, unsigned int deviceType, unsigned int fileIdentifier)
 {
 	if (destination != EndFileTransferPacket::kDestinationModem && destination != EndFileTransferPacket::kDestinationPhone)
 	{
@@ -1013,9 +1623,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		return (false);
 	}
 
-	FileTransferPacket *flashFileTransferPacket = new FileTransferPacket(FileTransferPacket::kRequestFlash);
-	bool success = SendPacket(flashFileTransferPacket);
-	delete flashFileTransferPacket;
+	FileTransferPacket flashFileTransferPacket(FileTransferPacket::kRequestFlash);
+	bool success = SendPacket(&flashFileTransferPacket);
 
 	if (!success)
 	{
@@ -1023,13 +1632,10 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		return (false);
 	}
 
-	FileSeek(file, 0, SEEK_END);
-	unsigned int fileSize = (unsigned int)FileTell(file);
-	FileRewind(file);
+	unsigned long long fileSize = fileSource->GetSize();
 
-	ResponsePacket *fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-	success = ReceivePacket(fileTransferResponse);
-	delete fileTransferResponse;
+	ResponsePacket fileTransferResponse(ResponsePacket::kResponseTypeFileTransfer);
+	success = ReceivePacket(&fileTransferResponse);
 
 	if (!success)
 	{
@@ -1037,35 +1643,37 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		return (false);
 	}
 
-	unsigned int sequenceCount = fileSize / (fileTransferSequenceMaxLength * fileTransferPacketSize);
-	unsigned int lastSequenceSize = fileTransferSequenceMaxLength;
-	unsigned int partialPacketByteCount = fileSize % fileTransferPacketSize;
+	FileTransferPlan transferPlan(fileSize, fileTransferPacketSize, fileTransferSequenceMaxLength);
+	unsigned int partCount = transferPlan.GetPartCount();
 
-	if (fileSize % (fileTransferSequenceMaxLength * fileTransferPacketSize) != 0)
+	if (!fileSource->Start(fileTransferPacketSize))
 	{
-		sequenceCount++;
-
-		unsigned int lastSequenceBytes = fileSize % (fileTransferSequenceMaxLength * fileTransferPacketSize);
-		lastSequenceSize = lastSequenceBytes / fileTransferPacketSize;
-
-		if (partialPacketByteCount != 0)
-			lastSequenceSize++;
+		Interface::PrintError("Failed to prepare file for transfer!\n");
+		return (false);
 	}
 
-	unsigned int bytesTransferred = 0;
+	unsigned long long bytesTransferred = 0;
 	unsigned int currentPercent;
 	unsigned int previousPercent = 0;
-	Interface::Print("0%%");
+	// When several devices are being flashed at once, progress is printed on separate lines.
+	bool lineProgress = Interface::HasOutputPrefix();
+	Interface::Print((lineProgress) ? "0%%\n" : "0%%");
+
+	unsigned int firstPartIndex = 0;
+	bool reportFirstByteTime = false;
 
-	for (unsigned int sequenceIndex = 0; sequenceIndex < sequenceCount; sequenceIndex++)
+	while (firstPartIndex < partCount)
 	{
-		bool isLastSequence = (sequenceIndex == sequenceCount - 1);
-		unsigned int sequenceSize = (isLastSequence) ? lastSequenceSize : fileTransferSequenceMaxLength;
+		// The sequence length may change between sequences whilst autotuning.
+		unsigned int sequenceLength = sequenceLengthTuner.GetSequenceLength();
+		unsigned int sequenceSize = (partCount - firstPartIndex < sequenceLength) ? partCount - firstPartIndex : sequenceLength;
 		unsigned int sequenceTotalByteCount = sequenceSize * fileTransferPacketSize;
+		bool isLastSequence = (firstPartIndex + sequenceSize == partCount);
 
-		FlashPartFileTransferPacket *beginFileTransferPacket = new FlashPartFileTransferPacket(sequenceTotalByteCount);
-		success = SendPacket(beginFileTransferPacket);
-		delete beginFileTransferPacket;
+		unsigned long long sequenceStartTime = Utility::GetMilliseconds();
+
+		FlashPartFileTransferPacket beginFileTransferPacket(sequenceTotalByteCount);
+		success = SendPacket(&beginFileTransferPacket);
 
 		if (!success)
 		{
@@ -1074,9 +1682,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			return (false);
 		}
 
-		fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-		bool success = ReceivePacket(fileTransferResponse);
-		delete fileTransferResponse;
+		ResponsePacket beginFileTransferResponse(ResponsePacket::kResponseTypeFileTransfer);
+		success = ReceivePacket(&beginFileTransferResponse);
 
 		if (!success)
 		{
@@ -1090,10 +1697,18 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			// NOTE: This empty transfer thing is entirely ridiculous, but sadly it seems to be required.
 			int sendEmptyTransferFlags = (filePartIndex == 0) ? kEmptyTransferNone : kEmptyTransferBefore;
 
+			unsigned char *partData = fileSource->AcquirePart();
+
+			if (!partData)
+			{
+				Interface::PrintErrorSameLine("\n");
+				Interface::PrintError("Failed to read file part!\n");
+				return (false);
+			}
+
 			// Send
-			SendFilePartPacket *sendFilePartPacket = new SendFilePartPacket(file, fileTransferPacketSize);
-			success = SendPacket(sendFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
-			delete sendFilePartPacket;
+			SendFilePartPacket sendFilePartPacket(partData, fileTransferPacketSize);
+			success = SendPacket(&sendFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
 
 			if (!success)
 			{
@@ -1102,12 +1717,16 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 				return (false);
 			}
 
-			// Response
-			SendFilePartResponse *sendFilePartResponse = new SendFilePartResponse();
-			success = ReceivePacket(sendFilePartResponse);
-			int receivedPartIndex = sendFilePartResponse->GetPartIndex();
+			if (firstByteTime == 0)
+			{
+				firstByteTime = Utility::GetMilliseconds();
+				reportFirstByteTime = true;
+			}
 
-			delete sendFilePartResponse;
+			// Response
+			SendFilePartResponse sendFilePartResponse;
+			success = ReceivePacket(&sendFilePartResponse);
+			int receivedPartIndex = sendFilePartResponse.GetPartIndex();
 
 			if (!success)
 			{
@@ -1119,10 +1738,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 					Interface::PrintErrorSameLine("\n");
 					Interface::PrintError("Retrying...");
 
-					// Send
-					sendFilePartPacket = new SendFilePartPacket(file, fileTransferPacketSize);
-					success = SendPacket(sendFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
-					delete sendFilePartPacket;
+					// Send (the part is held by the reader until it has been acknowledged)
+					success = SendPacket(&sendFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
 
 					if (!success)
 					{
@@ -1132,11 +1749,9 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 					}
 
 					// Response
-					sendFilePartResponse = new SendFilePartResponse();
-					success = ReceivePacket(sendFilePartResponse);
-					unsigned int receivedPartIndex = sendFilePartResponse->GetPartIndex();
-
-					delete sendFilePartResponse;
+					SendFilePartResponse retrySendFilePartResponse;
+					success = ReceivePacket(&retrySendFilePartResponse);
+					unsigned int receivedPartIndex = retrySendFilePartResponse.GetPartIndex();
 
 					if (receivedPartIndex != filePartIndex)
 					{
@@ -1160,6 +1775,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 				return (false);
 			}
 
+			fileSource->ReleasePart();
+
 			bytesTransferred += fileTransferPacketSize;
 
 			if (bytesTransferred > fileSize)
@@ -1169,7 +1786,12 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 
 			if (currentPercent != previousPercent)
 			{
-				if (!verbose)
+				if (lineProgress && !verbose)
+				{
+					if (currentPercent / 10 != previousPercent / 10)
+						Interface::Print("%d%%\n", currentPercent);
+				}
+				else if (!verbose)
 				{
 					if (previousPercent < 10)
 						Interface::Print("\b\b%d%%", currentPercent);
@@ -1185,15 +1807,14 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			previousPercent = currentPercent;
 		}
 
-		unsigned int sequenceEffectiveByteCount = (isLastSequence && partialPacketByteCount != 0) ?
-			fileTransferPacketSize * (lastSequenceSize - 1) + partialPacketByteCount : sequenceTotalByteCount;
+		unsigned long long partsEndTime = Utility::GetMilliseconds();
+		unsigned int sequenceEffectiveByteCount = (unsigned int)transferPlan.GetByteCount(firstPartIndex, sequenceSize);
 
 		if (destination == EndFileTransferPacket::kDestinationPhone)
 		{
-			EndPhoneFileTransferPacket *endPhoneFileTransferPacket = new EndPhoneFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, fileIdentifier, isLastSequence);
+			EndPhoneFileTransferPacket endPhoneFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, fileIdentifier, isLastSequence);
 
-			success = SendPacket(endPhoneFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
-			delete endPhoneFileTransferPacket;
+			success = SendPacket(&endPhoneFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
 
 			if (!success)
 			{
@@ -1204,10 +1825,9 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		}
 		else // destination == EndFileTransferPacket::kDestinationModem
 		{
-			EndModemFileTransferPacket *endModemFileTransferPacket = new EndModemFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, isLastSequence);
+			EndModemFileTransferPacket endModemFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, isLastSequence);
 
-			success = SendPacket(endModemFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
-			delete endModemFileTransferPacket;
+			success = SendPacket(&endModemFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
 
 			if (!success)
 			{
@@ -1217,9 +1837,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			}
 		}
 
-		fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-		success = ReceivePacket(fileTransferResponse, fileTransferSequenceTimeout);
-		delete fileTransferResponse;
+		ResponsePacket endFileTransferResponse(ResponsePacket::kResponseTypeFileTransfer);
+		success = ReceivePacket(&endFileTransferResponse, fileTransferSequenceTimeout);
 
 		if (!success)
 		{
@@ -1227,11 +1846,179 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			Interface::PrintError("Failed to confirm end of file transfer sequence!\n");
 			return (false);
 		}
+
+		unsigned long long sequenceEndTime = Utility::GetMilliseconds();
+
+		if (sequenceSize == sequenceLength)
+			sequenceLengthTuner.RecordSequence(sequenceLength, sequenceEffectiveByteCount, sequenceEndTime - sequenceStartTime);
+
+		if (autotune && verbose)
+		{
+			Interface::Print("Sequence of %u parts: %llu ms per part, %llu ms to end sequence\n", sequenceSize,
+				(partsEndTime - sequenceStartTime) / sequenceSize, sequenceEndTime - partsEndTime);
+		}
+
+		firstPartIndex += sequenceSize;
 	}
 
+	if (autotune)
+		UpdateDeviceProfile();
+
 	if (!verbose)
 		Interface::Print("\n");
 
+	// Reported so that the time spent getting ready to flash can be tracked.
+	if (reportFirstByteTime)
+		Interface::Print("Startup to first byte: %llu ms\n", firstByteTime - Utility::GetStartMilliseconds());
+
+	return (true);
+}
+
+bool BridgeManager::ReceiveDump(unsigned int chipType, unsigned int chipId, DumpFileWriter *writer) const
+{
+	BeginDumpPacket beginDumpPacket(chipType, chipId);
+	bool success = SendPacket(&beginDumpPacket);
+
+	if (!success)
+	{
+		Interface::PrintError("Failed to request dump!\n");
+		return (false);
+	}
+
+	DumpResponse dumpResponse;
+	success = ReceivePacket(&dumpResponse);
+
+	if (!success)
+	{
+		Interface::PrintError("Failed to receive dump size!\n");
+		return (false);
+	}
+
+	unsigned int dumpSize = dumpResponse.GetDumpSize();
+
+	if (!writer->Start(dumpSize))
+	{
+		Interface::PrintError("Failed to write dump to output file!\n");
+		return (false);
+	}
+
+	unsigned int offset = 0;
+	unsigned int currentPercent;
+	unsigned int previousPercent = 0;
+	bool lineProgress = Interface::HasOutputPrefix();
+	Interface::Print((lineProgress) ? "0%%\n" : "0%%");
+
+	while (offset < dumpSize)
+	{
+		unsigned char *buffer = writer->AcquireBuffer();
+
+		if (!buffer)
+		{
+			Interface::PrintErrorSameLine("\n");
+			Interface::PrintError("Failed to write dump to output file!\n");
+			return (false);
+		}
+
+		// Parts are received in place. The buffer holds a whole number of parts, so a device padding the final part
+		// can't overrun it.
+		unsigned int bufferSize = writer->GetBufferSize();
+		unsigned int bufferLength = 0;
+
+		while (bufferLength < bufferSize && offset < dumpSize)
+		{
+			// As with PIT files, parts are requested by index so that a device returning several parts in response to
+			// one request simply has us skip ahead.
+			unsigned int partIndex = offset / ReceiveFilePartPacket::kDataSize;
+
+			DumpPartFileTransferPacket requestPacket(partIndex);
+			success = SendPacket(&requestPacket);
+
+			if (!success)
+			{
+				Interface::PrintErrorSameLine("\n");
+				Interface::PrintError("Failed to request dump part #%u!\n", partIndex);
+				return (false);
+			}
+
+			ReceiveFilePartPacket receiveFilePartPacket(buffer + bufferLength, bufferSize - bufferLength);
+			success = ReceivePacket(&receiveFilePartPacket, kDefaultTimeoutReceive, kEmptyTransferNone);
+
+			if (success)
+			{
+				unsigned int receivedSize = receiveFilePartPacket.GetReceivedSize();
+				bufferLength += receivedSize;
+				offset += receivedSize;
+
+				if (receivedSize == 0 || (offset < dumpSize && receivedSize % ReceiveFilePartPacket::kDataSize != 0))
+					success = false;
+			}
+
+			if (!success)
+			{
+				Interface::PrintErrorSameLine("\n");
+				Interface::PrintError("Failed to receive dump part #%u!\n", partIndex);
+				return (false);
+			}
+		}
+
+		// Drop any padding the device added to the final part.
+		if (offset > dumpSize)
+		{
+			bufferLength -= offset - dumpSize;
+			offset = dumpSize;
+		}
+
+		writer->CommitBuffer(bufferLength);
+
+		currentPercent = (unsigned int)(100.0 * ((double)offset / (double)dumpSize));
+
+		if (currentPercent != previousPercent)
+		{
+			if (lineProgress && !verbose)
+			{
+				if (currentPercent / 10 != previousPercent / 10)
+					Interface::Print("%d%%\n", currentPercent);
+			}
+			else if (!verbose)
+			{
+				if (previousPercent < 10)
+					Interface::Print("\b\b%d%%", currentPercent);
+				else
+					Interface::Print("\b\b\b%d%%", currentPercent);
+			}
+			else
+			{
+				Interface::Print("\n%d%%\n", currentPercent);
+			}
+		}
+
+		previousPercent = currentPercent;
+	}
+
+	if (!verbose)
+		Interface::Print("\n");
+
+	if (ReceiveBulkTransfer(nullptr, 0, kDefaultTimeoutEmptyTransfer, false) < 0 && verbose)
+		Interface::PrintWarning("Empty bulk transfer after receiving packet failed. Continuing anyway...\n");
+
+	FileTransferPacket endDumpPacket(FileTransferPacket::kRequestEnd);
+	success = SendPacket(&endDumpPacket);
+
+	if (!success)
+	{
+		Interface::PrintError("Failed to send request to end dump!\n");
+		return (false);
+	}
+
+	ResponsePacket endDumpResponse(ResponsePacket::kResponseTypeFileTransfer);
+	success = ReceivePacket(&endDumpResponse);
+
+	if (!success)
+	{
+		Interface::PrintError("Failed to receive end dump verification!\n");
+		return (false);
+	}
+
 	return (true);
 }
 
@@ -21,11 +21,18 @@
 #ifndef BRIDGEMANAGER_H
 #define BRIDGEMANAGER_H
 
+// C/C++ Standard Library
+#include <functional>
+#include <string>
+#include <vector>
+
 // libpit
 #include "libpit.h"
 
 // Heimdall
 #include "Heimdall.h"
+#include "Interface.h"
+#include "SequenceLengthTuner.h"
 
 struct libusb_context;
 struct libusb_device;
@@ -33,6 +40,9 @@ struct libusb_device_handle;
 
 namespace Heimdall
 {
+	class DeviceProfile;
+	class DumpFileWriter;
+	class FilePartSource;
 	class InboundPacket;
 	class OutboundPacket;
 
@@ -82,7 +92,8 @@ namespace Heimdall
 			{
 				kDefaultTimeoutSend = 3000,
 				kDefaultTimeoutReceive = 3000,
-				kDefaultTimeoutEmptyTransfer = 100
+				kDefaultTimeoutEmptyTransfer = 100,
+				kTimeoutEmptyTransferCalibration = 500
 			};
 
 			enum class UsbLogLevel
@@ -96,6 +107,30 @@ namespace Heimdall
 				Default = Error
 			};
 
+			enum class UsbTransferMode
+			{
+				Sync = 0,
+				Async,
+
+				Default = Sync
+			};
+
+			enum
+			{
+				// Large bulk transfers are split into chunks of this size, several of which are queued at once in async
+				// mode. Must be a multiple of the bulk endpoint's max packet size.
+				kAsyncTransferChunkSize = 131072,
+				kAsyncTransferCount = 8
+			};
+
+			enum
+			{
+				// Used once the session has begun by devices that support changing the file part size (most do), unless
+				// autotuning chooses otherwise.
+				kFilePartSizeDefault = 1048576, // 1 MiB
+				kFileTransferSequenceMaxBytes = 31457280 // 30 MiB
+			};
+
 			enum
 			{
 				kEmptyTransferNone = 0,
@@ -127,11 +162,26 @@ namespace Heimdall
 
 #endif
 
+			std::string deviceLocation;
+			std::string deviceModel;
+			std::string serialNumber;
+
 			unsigned int fileTransferSequenceMaxLength;
 			unsigned int fileTransferPacketSize;
 			unsigned int fileTransferSequenceTimeout;
 
+			bool autotune;
+			bool emptyTransferCalibration;
+			bool emptyTransfersRequired;
+			DeviceProfile *deviceProfile;
+			SequenceLengthTuner sequenceLengthTuner;
+
 			UsbLogLevel usbLogLevel;
+			UsbTransferMode usbTransferMode;
+
+			unsigned long long firstByteTime;
+
+			static bool IsSupportedDevice(libusb_device *device);
 
 			int FindDeviceInterface(void);
 			bool ClaimDeviceInterface(void);
@@ -140,22 +190,61 @@ namespace Heimdall
 
 			bool InitialiseProtocol(void);
 
+			unsigned int ChooseFilePartSize(void) const;
+			bool SetFilePartSize(unsigned int filePartSize, bool *rejected);
+			void UpdateDeviceProfile(void);
+
+			bool CalibrateEmptyTransfers(void);
+			void ForgetEmptyTransferCalibration(void) const;
+
+			int SendBulkTransferAsync(unsigned char *data, int length, int timeout, int *dataTransferred) const;
 			bool SendBulkTransfer(unsigned char *data, int length, int timeout, bool retry = true) const;
 			int ReceiveBulkTransfer(unsigned char *data, int length, int timeout, bool retry = true) const;
 
+			bool SendPacketData(OutboundPacket *packet, int timeout, int emptyTransferFlags) const;
+			bool ReceivePacketData(InboundPacket *packet, int timeout, int emptyTransferFlags, bool retry) const;
+
 		public:
 
 			BridgeManager(bool verbose);
 			~BridgeManager();
 
+			// Retrieves the locations ("bus:port[.port...]") of all connected download-mode devices.
+			static bool GetDeviceLocations(std::vector<std::string>& locations);
+
+			// Reports the location of each download-mode device as soon as it's connected (including those already
+			// connected), for as long as keepWatching() returns true.
+			static bool WatchDevices(const std::function<void (const std::string& location)>& deviceArrived,
+				const std::function<bool (void)>& keepWatching);
+
 			bool DetectDevice(void);
 			int Initialise(bool resume);
 
 			bool BeginSession(void);
 			bool EndSession(bool reboot) const;
 
-			bool SendPacket(OutboundPacket *packet, int timeout = kDefaultTimeoutSend, int emptyTransferFlags = kEmptyTransferAfter) const;
-			bool ReceivePacket(InboundPacket *packet, int timeout = kDefaultTimeoutReceive, int emptyTransferFlags = kEmptyTransferNone) const;
+			// Packets are packed and unpacked by their concrete type, so no virtual dispatch is involved.
+			template <class PacketType>
+			bool SendPacket(PacketType *packet, int timeout = kDefaultTimeoutSend, int emptyTransferFlags = kEmptyTransferAfter) const
+			{
+				packet->Pack();
+				return (SendPacketData(packet, timeout, emptyTransferFlags));
+			}
+
+			template <class PacketType>
+			bool ReceivePacket(PacketType *packet, int timeout = kDefaultTimeoutReceive, int emptyTransferFlags = kEmptyTransferNone,
+				bool retry = true) const
+			{
+				if (!ReceivePacketData(packet, timeout, emptyTransferFlags, retry))
+					return (false);
+
+				bool unpacked = packet->Unpack();
+
+				if (!unpacked && verbose)
+					Interface::PrintError("Failed to unpack received packet.\n");
+
+				return (unpacked);
+			}
 
 			bool RequestDeviceType(unsigned int request, int *result) const;
 
@@ -163,7 +252,15 @@ namespace Heimdall
 			int ReceivePitFile(unsigned char **pitBuffer) const;
 			int DownloadPitFile(unsigned char **pitBuffer) const; // Thin wrapper around ReceivePitFile() with additional logging.
 
-			bool SendFile(FILE *file, unsigned int destination, unsigned int deviceType, unsigned int fileIdentifier = 0xFFFFFFFF) const;
+			// Cheaply checks whether a previously downloaded PIT file still matches the device's, by comparing its size
+			// and two of its parts, rather than downloading the whole PIT. Returns false (with matches false) if
+			// verification failed, in which case the PIT should be downloaded instead.
+			bool VerifyPitFile(const unsigned char *pitBuffer, unsigned int pitFileSize, bool *matches) const;
+
+			bool SendFile(FilePartSource *fileSource, unsigned int destination, unsigned int deviceType, unsigned int fileIdentifier = 0xFFFFFFFF);
+
+			// Dumps the given chip's contents, handing them to writer as they're received.
+			bool ReceiveDump(unsigned int chipType, unsigned int chipId, DumpFileWriter *writer) const;
 
 			void SetUsbLogLevel(UsbLogLevel usbLogLevel);
 
@@ -172,6 +269,73 @@ namespace Heimdall
 				return usbLogLevel;
 			}
 
+			void SetUsbTransferMode(UsbTransferMode usbTransferMode)
+			{
+				this->usbTransferMode = usbTransferMode;
+			}
+
+			UsbTransferMode GetUsbTransferMode(void) const
+			{
+				return usbTransferMode;
+			}
+
+			// Measures transfer performance, choosing the file part size and sequence length that give the greatest
+			// throughput. The results are kept per device model, so later sessions start with the best values found.
+			void SetAutotune(bool autotune)
+			{
+				this->autotune = autotune;
+			}
+
+			bool GetAutotune(void) const
+			{
+				return (autotune);
+			}
+
+			// Determines at the start of the session whether the bootloader needs the empty transfers that are normally
+			// sent around packets, and skips them if not. The result is kept per device model.
+			void SetEmptyTransferCalibration(bool emptyTransferCalibration)
+			{
+				this->emptyTransferCalibration = emptyTransferCalibration;
+			}
+
+			bool GetEmptyTransferCalibration(void) const
+			{
+				return (emptyTransferCalibration);
+			}
+
+			// Restricts the bridge to the device at the given location, rather than the first device found.
+			void SetDeviceLocation(const std::string& deviceLocation)
+			{
+				this->deviceLocation = deviceLocation;
+			}
+
+			const std::string& GetDeviceLocation(void) const
+			{
+				return (deviceLocation);
+			}
+
+			// Identifies the model (and bootloader revision) of the connected device, available once initialised.
+			const std::string& GetDeviceModel(void) const
+			{
+				return (deviceModel);
+			}
+
+			const std::string& GetSerialNumber(void) const
+			{
+				return (serialNumber);
+			}
+
+			// File transfer parameters, which are only final once the session has begun.
+			unsigned int GetFilePartSize(void) const
+			{
+				return (fileTransferPacketSize);
+			}
+
+			unsigned int GetFileTransferSequenceMaxLength(void) const
+			{
+				return (fileTransferSequenceMaxLength);
+			}
+
 			bool IsVerbose(void) const
 			{
 				return (verbose);
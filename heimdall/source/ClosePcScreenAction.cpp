@@ -30,7 +30,7 @@ using namespace Heimdall;
 
 const char *ClosePcScreenAction::usage = "Action: close-pc-screen\n\
 Arguments: [--verbose] [--no-reboot] [--resume] [--stdout-errors]\n\
-           [--usb-log-level <none/error/warning/debug>]\n\
+           [--usb-log-level <none/error/warning/debug>] [--no-delay]\n\
 Description: Attempts to get rid off the \"connect phone to PC\" screen.\n\
 Note: --no-reboot causes the device to remain in download mode after the action\n\
       is completed. If you wish to perform another action whilst remaining in\n\
@@ -45,6 +45,7 @@ int ClosePcScreenAction::Execute(int argc, char **argv)
 	argumentTypes["resume"] = kArgumentTypeFlag;
 	argumentTypes["verbose"] = kArgumentTypeFlag;
 	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["no-delay"] = kArgumentTypeFlag;
 	argumentTypes["usb-log-level"] = kArgumentTypeString;
 
 	Arguments arguments(argumentTypes);
@@ -97,10 +98,13 @@ int ClosePcScreenAction::Execute(int argc, char **argv)
 	if (arguments.GetArgument("stdout-errors") != nullptr)
 		Interface::SetStdoutErrors(true);
 
+	if (arguments.GetArgument("no-delay") != nullptr)
+		Interface::SetNoDelay(true);
+
 	// Info
 
 	Interface::PrintReleaseInfo();
-	Sleep(1000);
+	Interface::Pause(1000);
 
 	// Download PIT file from device.
 
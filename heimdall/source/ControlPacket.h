@@ -26,7 +26,7 @@
 
 namespace Heimdall
 {
-	class ControlPacket : public OutboundPacket
+	class ControlPacket : private PacketStorage<1024>, public OutboundPacket
 	{
 		public:
 
@@ -40,9 +40,12 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::PackedLayout<0, unsigned int> Layout;
+
 			enum
 			{
-				kDataSize = 4
+				kSize = 1024,
+				kDataSize = Layout::kEnd
 			};
 
 		private:
@@ -51,7 +54,7 @@ namespace Heimdall
 
 		public:
 
-			ControlPacket(unsigned int controlType) : OutboundPacket(1024)
+			ControlPacket(unsigned int controlType) : OutboundPacket(storage.data(), kSize)
 			{
 				this->controlType = controlType;
 			}
@@ -61,9 +64,9 @@ namespace Heimdall
 				return (controlType);
 			}
 
-			virtual void Pack(void)
+			void Pack(void)
 			{
-				PackInteger(0, controlType);
+				Layout::Pack(data, controlType);
 			}
 	};
 }
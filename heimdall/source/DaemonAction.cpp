@@ -0,0 +1,631 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <signal.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Heimdall
+#include "Arguments.h"
+#include "BridgeManager.h"
+#include "DaemonAction.h"
+#include "DeviceSession.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *DaemonAction::usage = "Action: daemon\n\
+Arguments: [--socket <path>] [--verbose] [--resume] [--stdout-errors]\n\
+    [--usb-log-level <none/error/warning/debug>] [--usb-transfer-mode <sync/async>]\n\
+  or:\n\
+    --send <command> [--socket <path>]\n\
+Description: Runs in the background, keeping a session open with each device it's\n\
+    asked to work with, so that successive commands needn't initialise the\n\
+    device, begin a session and download the PIT each time. Commands are\n\
+    accepted on a Unix domain socket, by default heimdalld.sock in Heimdall's\n\
+    cache directory, one per line. Output from each command is sent back\n\
+    followed by a line of \"heimdalld: OK\" or \"heimdalld: FAILED\".\n\
+    --send connects to a running daemon, sends a single command and prints its\n\
+    output, exiting with 0 if the command succeeded.\n\
+    As well as the device commands listed below, the daemon accepts \"devices\" (lists\n\
+    connected devices), \"device <bus:port>\" (directs later commands on the\n\
+    same connection to that device, otherwise the first device found is used)\n\
+    and \"shutdown\". On shutdown, open sessions are ended without rebooting.\n\
+Commands:\n\
+    print-pit\n\
+    download-pit <filename>\n\
+    flash <partition name/identifier> <filename> [<partition> <filename> ...]\n\
+    end-session [--no-reboot]\n";
+
+#ifdef _WIN32
+
+int DaemonAction::Execute(int argc, char **argv)
+{
+	Interface::PrintError("The daemon action is not supported on Windows.\n");
+	return (1);
+}
+
+#else
+
+struct DaemonOptions
+{
+	bool verbose;
+	bool resume;
+
+	BridgeManager::UsbLogLevel usbLogLevel;
+	BridgeManager::UsbTransferMode usbTransferMode;
+};
+
+struct DaemonSession
+{
+	mutex sessionMutex;
+	DeviceSession *deviceSession;
+
+	DaemonSession(DeviceSession *deviceSession)
+	{
+		this->deviceSession = deviceSession;
+	}
+
+	~DaemonSession()
+	{
+		delete deviceSession;
+	}
+};
+
+static const char *kStatusSucceeded = "heimdalld: OK\n";
+static const char *kStatusFailed = "heimdalld: FAILED\n";
+
+static volatile sig_atomic_t daemonStopping = 0;
+static int listenSocket = -1;
+
+static mutex daemonMutex;
+static map<string, shared_ptr<DaemonSession>> sessions;
+static set<int> clientSockets;
+
+// Client threads are detached, so that a long running daemon doesn't accumulate finished threads. Shutdown waits for
+// those still running to finish.
+static unsigned int clientCount = 0;
+static condition_variable clientFinishedCondition;
+
+static void daemonInterruptHandler(int)
+{
+	daemonStopping = 1;
+
+	// Wakes the accept() call in the main loop.
+	shutdown(listenSocket, SHUT_RDWR);
+}
+
+static void stopDaemon(void)
+{
+	lock_guard<mutex> lock(daemonMutex);
+
+	daemonStopping = 1;
+	shutdown(listenSocket, SHUT_RDWR);
+}
+
+static bool getSocketAddress(const string& socketPath, sockaddr_un& address)
+{
+	if (socketPath.length() >= sizeof(address.sun_path))
+	{
+		Interface::PrintError("Socket path is too long: %s\n", socketPath.c_str());
+		return (false);
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath.c_str());
+
+	return (true);
+}
+
+static int connectToDaemon(const string& socketPath)
+{
+	sockaddr_un address;
+
+	if (!getSocketAddress(socketPath, address))
+		return (-1);
+
+	int clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (clientSocket < 0)
+		return (-1);
+
+	if (connect(clientSocket, (const sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(clientSocket);
+		return (-1);
+	}
+
+	return (clientSocket);
+}
+
+static shared_ptr<DaemonSession> getSession(const DaemonOptions& options, const string& deviceLocation)
+{
+	lock_guard<mutex> lock(daemonMutex);
+
+	shared_ptr<DaemonSession>& session = sessions[deviceLocation];
+
+	if (!session)
+	{
+		BridgeManager *bridgeManager = new BridgeManager(options.verbose);
+		bridgeManager->SetUsbLogLevel(options.usbLogLevel);
+		bridgeManager->SetUsbTransferMode(options.usbTransferMode);
+		bridgeManager->SetDeviceLocation(deviceLocation);
+
+		session = make_shared<DaemonSession>(new DeviceSession(bridgeManager, options.resume));
+	}
+
+	return (session);
+}
+
+static void removeSession(const string& deviceLocation, const shared_ptr<DaemonSession>& session)
+{
+	lock_guard<mutex> lock(daemonMutex);
+
+	map<string, shared_ptr<DaemonSession>>::iterator it = sessions.find(deviceLocation);
+
+	if (it != sessions.end() && it->second == session)
+		sessions.erase(it);
+}
+
+static bool listDevices(void)
+{
+	vector<string> deviceLocations;
+
+	if (!BridgeManager::GetDeviceLocations(deviceLocations))
+		return (false);
+
+	lock_guard<mutex> lock(daemonMutex);
+
+	for (unsigned int i = 0; i < deviceLocations.size(); i++)
+	{
+		bool open = sessions.find(deviceLocations[i]) != sessions.end();
+		Interface::Print("%s%s\n", deviceLocations[i].c_str(), open ? " (session open)" : "");
+	}
+
+	return (true);
+}
+
+static bool runCommand(const DaemonOptions& options, string& deviceLocation, const vector<string>& arguments)
+{
+	const string& command = arguments[0];
+
+	if (command == "devices")
+	{
+		return (listDevices());
+	}
+	else if (command == "device")
+	{
+		if (arguments.size() != 2)
+		{
+			Interface::PrintError("device expects a location e.g. 1:4.2\n");
+			return (false);
+		}
+
+		deviceLocation = arguments[1];
+		return (true);
+	}
+	else if (command == "shutdown")
+	{
+		stopDaemon();
+		return (true);
+	}
+
+	string location = deviceLocation;
+
+	if (location.empty())
+	{
+		vector<string> deviceLocations;
+
+		if (!BridgeManager::GetDeviceLocations(deviceLocations))
+			return (false);
+
+		if (deviceLocations.empty())
+		{
+			Interface::PrintDeviceDetectionFailed();
+			return (false);
+		}
+
+		location = deviceLocations[0];
+	}
+
+	shared_ptr<DaemonSession> session = getSession(options, location);
+	bool success;
+
+	{
+		lock_guard<mutex> lock(session->sessionMutex);
+
+		success = session->deviceSession->RunCommand(arguments);
+
+		// A rebooted device will come back with a new session, if at all. Likewise, after a failure (e.g. the device
+		// being unplugged and plugged back in), the next command starts afresh rather than using a dead device handle.
+		if (session->deviceSession->HasRebooted() || session->deviceSession->HasFailed())
+			removeSession(location, session);
+	}
+
+	return (success);
+}
+
+static void serveClient(const DaemonOptions& options, int clientSocket)
+{
+	FILE *input = fdopen(clientSocket, "r");
+	FILE *output = fdopen(dup(clientSocket), "w");
+
+	if (!input || !output)
+	{
+		if (input)
+			fclose(input);
+		else
+			close(clientSocket);
+
+		if (output)
+			fclose(output);
+
+		return;
+	}
+
+	Interface::SetOutputFile(output);
+
+	string deviceLocation;
+	string line;
+	char buffer[512];
+
+	while (fgets(buffer, sizeof(buffer), input))
+	{
+		line += buffer;
+
+		if (line.empty() || line[line.length() - 1] != '\n')
+			continue;
+
+		vector<string> arguments;
+		bool success;
+
+		if (!DeviceSession::ParseCommand(line, arguments))
+		{
+			Interface::PrintError("Unbalanced quotes in command: %s", line.c_str());
+			success = false;
+		}
+		else if (arguments.empty())
+		{
+			line.clear();
+			continue;
+		}
+		else
+		{
+			if (options.verbose)
+			{
+				Interface::SetOutputFile(nullptr);
+				Interface::Print("Command: %s", line.c_str());
+				Interface::SetOutputFile(output);
+			}
+
+			success = runCommand(options, deviceLocation, arguments);
+		}
+
+		line.clear();
+
+		fputs(success ? kStatusSucceeded : kStatusFailed, output);
+		fflush(output);
+	}
+
+	Interface::SetOutputFile(nullptr);
+
+	{
+		lock_guard<mutex> lock(daemonMutex);
+		clientSockets.erase(clientSocket);
+	}
+
+	fclose(output);
+	fclose(input);
+
+	{
+		lock_guard<mutex> lock(daemonMutex);
+		clientCount--;
+	}
+
+	clientFinishedCondition.notify_all();
+}
+
+static int sendCommand(const string& socketPath, const string& command)
+{
+	int clientSocket = connectToDaemon(socketPath);
+
+	if (clientSocket < 0)
+	{
+		Interface::PrintError("Failed to connect to daemon at %s\n", socketPath.c_str());
+		return (1);
+	}
+
+	string request = command + "\n";
+
+	if (write(clientSocket, request.c_str(), request.length()) != (ssize_t)request.length())
+	{
+		Interface::PrintError("Failed to send command to daemon.\n");
+		close(clientSocket);
+		return (1);
+	}
+
+	shutdown(clientSocket, SHUT_WR);
+
+	FILE *input = fdopen(clientSocket, "r");
+	string line;
+	char buffer[512];
+	int result = 1;
+
+	while (fgets(buffer, sizeof(buffer), input))
+	{
+		line += buffer;
+
+		if (line[line.length() - 1] != '\n')
+			continue;
+
+		if (line == kStatusSucceeded || line == kStatusFailed)
+		{
+			result = (line == kStatusSucceeded) ? 0 : 1;
+			break;
+		}
+
+		fputs(line.c_str(), stdout);
+		fflush(stdout);
+		line.clear();
+	}
+
+	fclose(input);
+
+	return (result);
+}
+
+static int runDaemon(const DaemonOptions& options, const string& socketPath)
+{
+	sockaddr_un address;
+
+	if (!getSocketAddress(socketPath, address))
+		return (1);
+
+	// A socket file left behind by a daemon that didn't exit cleanly is replaced, but not one that's in use.
+	int existingSocket = connectToDaemon(socketPath);
+
+	if (existingSocket >= 0)
+	{
+		close(existingSocket);
+		Interface::PrintError("A daemon is already listening at %s\n", socketPath.c_str());
+		return (1);
+	}
+
+	unlink(socketPath.c_str());
+
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	// Anyone able to connect can flash devices, so the socket is created accessible only to its owner, rather than
+	// being restricted after it's been bound (when another user could already have connected).
+	bool bound = false;
+
+	if (listenSocket >= 0)
+	{
+		mode_t previousMask = umask(0077);
+		bound = bind(listenSocket, (const sockaddr *)&address, sizeof(address)) == 0;
+		umask(previousMask);
+	}
+
+	if (!bound || listen(listenSocket, 8) != 0)
+	{
+		Interface::PrintError("Failed to listen at %s\n", socketPath.c_str());
+
+		if (listenSocket >= 0)
+			close(listenSocket);
+
+		unlink(socketPath.c_str());
+		return (1);
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, daemonInterruptHandler);
+	signal(SIGTERM, daemonInterruptHandler);
+
+	Interface::Print("Listening at %s\n", socketPath.c_str());
+
+	while (!daemonStopping)
+	{
+		int clientSocket = accept(listenSocket, nullptr, nullptr);
+
+		if (clientSocket < 0)
+			continue;
+
+		lock_guard<mutex> lock(daemonMutex);
+
+		if (daemonStopping)
+		{
+			close(clientSocket);
+			break;
+		}
+
+		clientSockets.insert(clientSocket);
+		clientCount++;
+
+		thread(serveClient, options, clientSocket).detach();
+	}
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+
+	Interface::Print("Shutting down...\n");
+
+	{
+		// Clients waiting for their next command are disconnected, but commands already running are finished.
+		unique_lock<mutex> lock(daemonMutex);
+
+		for (set<int>::const_iterator it = clientSockets.begin(); it != clientSockets.end(); it++)
+			shutdown(*it, SHUT_RD);
+
+		while (clientCount > 0)
+			clientFinishedCondition.wait(lock);
+	}
+
+	bool success = true;
+
+	for (map<string, shared_ptr<DaemonSession>>::const_iterator it = sessions.begin(); it != sessions.end(); it++)
+	{
+		if (!it->second->deviceSession->End(false))
+			success = false;
+	}
+
+	sessions.clear();
+
+	close(listenSocket);
+	unlink(socketPath.c_str());
+
+	return (success ? 0 : 1);
+}
+
+int DaemonAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["socket"] = kArgumentTypeString;
+	argumentTypes["send"] = kArgumentTypeString;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["usb-transfer-mode"] = kArgumentTypeString;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(DaemonAction::usage);
+		return (0);
+	}
+
+	string socketPath;
+	const StringArgument *socketArgument = static_cast<const StringArgument *>(arguments.GetArgument("socket"));
+
+	if (socketArgument)
+	{
+		socketPath = socketArgument->GetValue();
+	}
+	else if (Utility::GetCacheDirectory(socketPath))
+	{
+		socketPath += "/heimdalld.sock";
+	}
+	else
+	{
+		Interface::PrintError("Failed to determine the cache directory, --socket must be specified.\n");
+		return (1);
+	}
+
+	const StringArgument *sendArgument = static_cast<const StringArgument *>(arguments.GetArgument("send"));
+
+	if (sendArgument)
+		return (sendCommand(socketPath, sendArgument->GetValue()));
+
+	DaemonOptions options;
+	options.resume = arguments.GetArgument("resume") != nullptr;
+	options.verbose = arguments.GetArgument("verbose") != nullptr;
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	options.usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			options.usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			options.usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			options.usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			options.usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			options.usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(DaemonAction::usage);
+			return (0);
+		}
+	}
+
+	const StringArgument *usbTransferModeArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-transfer-mode"));
+
+	options.usbTransferMode = BridgeManager::UsbTransferMode::Default;
+
+	if (usbTransferModeArgument)
+	{
+		const string& usbTransferModeString = usbTransferModeArgument->GetValue();
+
+		if (usbTransferModeString.compare("sync") == 0 || usbTransferModeString.compare("SYNC") == 0)
+		{
+			options.usbTransferMode = BridgeManager::UsbTransferMode::Sync;
+		}
+		else if (usbTransferModeString.compare("async") == 0 || usbTransferModeString.compare("ASYNC") == 0)
+		{
+			options.usbTransferMode = BridgeManager::UsbTransferMode::Async;
+		}
+		else
+		{
+			Interface::Print("Unknown USB transfer mode: %s\n\n", usbTransferModeString.c_str());
+			Interface::Print(DaemonAction::usage);
+			return (0);
+		}
+	}
+
+	Interface::PrintReleaseInfo();
+
+	return (runDaemon(options, socketPath));
+}
+
+#endif
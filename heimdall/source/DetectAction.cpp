@@ -31,7 +31,9 @@ using namespace Heimdall;
 const char *DetectAction::usage = "Action: detect\n\
 Arguments: [--verbose] [--stdout-errors]\n\
            [--usb-log-level <none/error/warning/debug>]\n\
-Description: Indicates whether or not a download mode device can be detected.\n";
+Description: Indicates whether or not a download mode device can be detected.\n\
+    With --verbose, the USB location of each device is also listed, for use\n\
+    with flash --devices.\n";
 
 int DetectAction::Execute(int argc, char **argv)
 {
@@ -98,6 +100,14 @@ int DetectAction::Execute(int argc, char **argv)
 
 	bool detected = bridgeManager->DetectDevice();
 
+	vector<string> deviceLocations;
+
+	if (detected && verbose && BridgeManager::GetDeviceLocations(deviceLocations))
+	{
+		for (unsigned int i = 0; i < deviceLocations.size(); i++)
+			Interface::Print("    %s\n", deviceLocations[i].c_str());
+	}
+
 	delete bridgeManager;
 
 	return ((detected) ? 0 : 1);
@@ -0,0 +1,134 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+// Heimdall
+#include "DeviceProfile.h"
+#include "Heimdall.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+static mutex profileMutex;
+
+DeviceProfile::DeviceProfile(const string& deviceModel)
+{
+	if (!Utility::GetCacheFilePath(path, "devices", deviceModel, ".txt"))
+		path.clear();
+}
+
+bool DeviceProfile::ReadValues(const string& path, map<string, string>& values)
+{
+	FILE *file = fopen(path.c_str(), "r");
+
+	if (!file)
+		return (false);
+
+	char line[256];
+
+	while (fgets(line, sizeof(line), file))
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+
+		char *separator = strchr(line, '=');
+
+		if (separator)
+		{
+			*separator = '\0';
+			values[line] = separator + 1;
+		}
+	}
+
+	fclose(file);
+	return (true);
+}
+
+bool DeviceProfile::Load(void)
+{
+	if (path.empty())
+		return (false);
+
+	lock_guard<mutex> lock(profileMutex);
+	return (ReadValues(path, values));
+}
+
+bool DeviceProfile::Save(void) const
+{
+	if (path.empty())
+		return (false);
+
+	lock_guard<mutex> lock(profileMutex);
+
+	map<string, string> savedValues;
+	ReadValues(path, savedValues);
+
+	for (set<string>::const_iterator it = changedKeys.begin(); it != changedKeys.end(); it++)
+	{
+		map<string, string>::const_iterator value = values.find(*it);
+
+		if (value != values.end())
+			savedValues[*it] = value->second;
+		else
+			savedValues.erase(*it);
+	}
+
+	return (Utility::WriteFileAtomically(path, "w", [&savedValues](FILE *file)
+	{
+		for (map<string, string>::const_iterator it = savedValues.begin(); it != savedValues.end(); it++)
+			fprintf(file, "%s=%s\n", it->first.c_str(), it->second.c_str());
+
+		return (true);
+	}));
+}
+
+unsigned int DeviceProfile::GetUnsignedInt(const string& key, unsigned int defaultValue) const
+{
+	map<string, string>::const_iterator it = values.find(key);
+
+	if (it == values.end())
+		return (defaultValue);
+
+	unsigned int value;
+
+	if (Utility::ParseUnsignedInt(value, it->second.c_str()) != kNumberParsingStatusSuccess)
+		return (defaultValue);
+
+	return (value);
+}
+
+void DeviceProfile::SetUnsignedInt(const string& key, unsigned int value)
+{
+	char buffer[16];
+	sprintf(buffer, "%u", value);
+
+	values[key] = buffer;
+	changedKeys.insert(key);
+}
+
+void DeviceProfile::RemoveValue(const string& key)
+{
+	values.erase(key);
+	changedKeys.insert(key);
+}
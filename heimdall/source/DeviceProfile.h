@@ -0,0 +1,68 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef DEVICEPROFILE_H
+#define DEVICEPROFILE_H
+
+// C/C++ Standard Library
+#include <map>
+#include <set>
+#include <string>
+
+namespace Heimdall
+{
+	// Settings learnt about a particular model of device (e.g. tuned transfer parameters), persisted in the cache
+	// directory as "key=value" lines so that later sessions can start with them.
+	class DeviceProfile
+	{
+		private:
+
+			std::string path;
+			std::map<std::string, std::string> values;
+
+			// Only values that have been set or removed are saved, so that those saved by other sessions since this profile
+			// was loaded (e.g. when flashing several devices of the same model at once) aren't overwritten with stale ones.
+			std::set<std::string> changedKeys;
+
+			static bool ReadValues(const std::string& path, std::map<std::string, std::string>& values);
+
+		public:
+
+			DeviceProfile(const std::string& deviceModel);
+
+			bool Load(void);
+
+			// Several sessions may save the same profile at once, so saving is serialised and the profile is replaced
+			// whole, rather than rewritten in place.
+			bool Save(void) const;
+
+			bool HasValue(const std::string& key) const
+			{
+				return (values.find(key) != values.end());
+			}
+
+			unsigned int GetUnsignedInt(const std::string& key, unsigned int defaultValue = 0) const;
+			void SetUnsignedInt(const std::string& key, unsigned int value);
+
+			void RemoveValue(const std::string& key);
+	};
+}
+
+#endif
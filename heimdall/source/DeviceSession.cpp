@@ -0,0 +1,422 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "BridgeManager.h"
+#include "DeviceSession.h"
+#include "EndModemFileTransferPacket.h"
+#include "EndPhoneFileTransferPacket.h"
+#include "FilePartSource.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "SessionSetupResponse.h"
+#include "TotalBytesPacket.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace libpit;
+using namespace Heimdall;
+
+const char *DeviceSession::commandUsage = "Commands:\n\
+    print-pit\n\
+    download-pit <filename>\n\
+    flash <partition name/identifier> <filename> [<partition> <filename> ...]\n\
+    end-session [--no-reboot]\n";
+
+DeviceSession::DeviceSession(BridgeManager *bridgeManager, bool resume)
+{
+	this->bridgeManager = bridgeManager;
+	this->resume = resume;
+
+	initialised = false;
+	sessionOpen = false;
+	rebooted = false;
+	failed = false;
+
+	pitBuffer = nullptr;
+	pitFileSize = 0;
+	pitData = nullptr;
+}
+
+DeviceSession::~DeviceSession()
+{
+	DiscardPit();
+	delete bridgeManager;
+}
+
+bool DeviceSession::RequirePit(void)
+{
+	if (pitData)
+		return (true);
+
+	// The PIT is only downloaded once per session, as it can't change unless the device is repartitioned (which is
+	// done by the flash action rather than in a session).
+	pitFileSize = bridgeManager->DownloadPitFile(&pitBuffer);
+
+	if (pitFileSize == 0)
+	{
+		pitBuffer = nullptr;
+		failed = true;
+		return (false);
+	}
+
+	pitData = new PitData();
+
+	if (!pitData->Unpack(pitBuffer))
+	{
+		Interface::PrintError("Failed to unpack device's PIT file!\n");
+		DiscardPit();
+		return (false);
+	}
+
+	return (true);
+}
+
+void DeviceSession::DiscardPit(void)
+{
+	delete pitData;
+	pitData = nullptr;
+
+	delete [] pitBuffer;
+	pitBuffer = nullptr;
+	pitFileSize = 0;
+}
+
+bool DeviceSession::Begin(void)
+{
+	if (sessionOpen)
+		return (true);
+
+	if (rebooted)
+	{
+		Interface::PrintError("The device has been rebooted, so a session can no longer be begun.\n");
+		return (false);
+	}
+
+	if (!initialised)
+	{
+		if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded)
+		{
+			failed = true;
+			return (false);
+		}
+
+		initialised = true;
+	}
+
+	if (!bridgeManager->BeginSession())
+	{
+		failed = true;
+		return (false);
+	}
+
+	sessionOpen = true;
+	return (true);
+}
+
+bool DeviceSession::End(bool reboot)
+{
+	if (!sessionOpen)
+		return (true);
+
+	sessionOpen = false;
+	DiscardPit();
+
+	bool success = bridgeManager->EndSession(reboot);
+
+	if (!success)
+		failed = true;
+	else if (reboot)
+		rebooted = true;
+
+	return (success);
+}
+
+bool DeviceSession::DownloadPit(const string& filename)
+{
+	if (!RequirePit())
+		return (false);
+
+	FILE *outputPitFile = FileOpen(filename.c_str(), "wb");
+
+	if (!outputPitFile)
+	{
+		Interface::PrintError("Failed to open output file \"%s\"\n", filename.c_str());
+		return (false);
+	}
+
+	bool success = fwrite(pitBuffer, 1, pitFileSize, outputPitFile) == pitFileSize;
+	FileClose(outputPitFile);
+
+	if (!success)
+		Interface::PrintError("Failed to write PIT data to output file.\n");
+
+	return (success);
+}
+
+bool DeviceSession::PrintPit(void)
+{
+	if (!RequirePit())
+		return (false);
+
+	Interface::PrintPit(pitData);
+	return (true);
+}
+
+bool DeviceSession::Flash(const vector<string>& arguments)
+{
+	if (arguments.size() < 3 || arguments.size() % 2 == 0)
+	{
+		Interface::PrintError("flash expects pairs of partitions and filenames.\n");
+		return (false);
+	}
+
+	if (!RequirePit())
+		return (false);
+
+	vector<const PitEntry *> pitEntries;
+	vector<FILE *> files;
+	unsigned long long totalBytes = 0;
+	bool success = true;
+
+	for (unsigned int i = 1; i < arguments.size(); i += 2)
+	{
+		// Partitions may be given as they are to the flash action, e.g. --BOOT.
+		string partition = arguments[i];
+
+		if (partition.compare(0, 2, "--") == 0)
+			partition.erase(0, 2);
+
+		const string& filename = arguments[i + 1];
+		const PitEntry *pitEntry;
+
+		unsigned int partitionIdentifier;
+
+		if (Utility::ParseUnsignedInt(partitionIdentifier, partition.c_str()) == kNumberParsingStatusSuccess)
+			pitEntry = pitData->FindEntry(partitionIdentifier);
+		else
+			pitEntry = pitData->FindEntry(partition.c_str());
+
+		if (!pitEntry)
+		{
+			Interface::PrintError("Partition \"%s\" does not exist in the device's PIT.\n", partition.c_str());
+			success = false;
+			break;
+		}
+
+		FILE *file = FileOpen(filename.c_str(), "rb");
+
+		if (!file)
+		{
+			Interface::PrintError("Failed to open file \"%s\"\n", filename.c_str());
+			success = false;
+			break;
+		}
+
+		pitEntries.push_back(pitEntry);
+		files.push_back(file);
+
+		unsigned long long dataSize;
+
+		if (!FilePartSource::GetDataSize(file, &dataSize))
+		{
+			Interface::PrintError("Failed to read file \"%s\"\n", filename.c_str());
+			success = false;
+			break;
+		}
+
+		totalBytes += dataSize;
+	}
+
+	if (success)
+	{
+		// The device is told how much is to be flashed by each command, rather than once for the whole session.
+		TotalBytesPacket totalBytesPacket(totalBytes);
+		SessionSetupResponse totalBytesResponse;
+
+		if (!bridgeManager->SendPacket(&totalBytesPacket) || !bridgeManager->ReceivePacket(&totalBytesResponse))
+		{
+			Interface::PrintError("Failed to send total bytes packet!\n");
+			success = false;
+			failed = true;
+		}
+		else if (totalBytesResponse.GetResult() != 0)
+		{
+			Interface::PrintError("Unexpected session total bytes response!\nExpected: 0\nReceived:%d\n",
+				totalBytesResponse.GetResult());
+			success = false;
+		}
+	}
+
+	for (unsigned int i = 0; success && i < files.size(); i++)
+	{
+		const PitEntry *pitEntry = pitEntries[i];
+		FilePartSource *fileSource = FilePartSource::Create(files[i]);
+
+		Interface::Print("Uploading %s\n", pitEntry->GetPartitionName());
+
+		if (pitEntry->GetBinaryType() == PitEntry::kBinaryTypeCommunicationProcessor) // Modem
+		{
+			success = bridgeManager->SendFile(fileSource, EndModemFileTransferPacket::kDestinationModem,
+				pitEntry->GetDeviceType());
+		}
+		else // pitEntry->GetBinaryType() == PitEntry::kBinaryTypeApplicationProcessor
+		{
+			success = bridgeManager->SendFile(fileSource, EndPhoneFileTransferPacket::kDestinationPhone,
+				pitEntry->GetDeviceType(), pitEntry->GetIdentifier());
+		}
+
+		delete fileSource;
+
+		if (success)
+		{
+			Interface::Print("%s upload successful\n\n", pitEntry->GetPartitionName());
+		}
+		else
+		{
+			Interface::PrintError("%s upload failed!\n\n", pitEntry->GetPartitionName());
+			failed = true;
+		}
+	}
+
+	for (unsigned int i = 0; i < files.size(); i++)
+		FileClose(files[i]);
+
+	return (success);
+}
+
+bool DeviceSession::ParseCommand(const string& line, vector<string>& arguments)
+{
+	arguments.clear();
+
+	string argument;
+	bool inArgument = false;
+	bool quoted = false;
+
+	for (string::size_type i = 0; i < line.length(); i++)
+	{
+		char c = line[i];
+
+		if (c == '"')
+		{
+			quoted = !quoted;
+			inArgument = true;
+		}
+		else if (quoted)
+		{
+			argument += c;
+		}
+		else if (c == '#')
+		{
+			break;
+		}
+		else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			if (inArgument)
+			{
+				arguments.push_back(argument);
+				argument.clear();
+				inArgument = false;
+			}
+		}
+		else
+		{
+			argument += c;
+			inArgument = true;
+		}
+	}
+
+	if (inArgument)
+		arguments.push_back(argument);
+
+	return (!quoted);
+}
+
+bool DeviceSession::IsCommand(const string& command)
+{
+	return (command == "print-pit" || command == "download-pit" || command == "flash" || command == "end-session"
+		|| command == "close-pc-screen");
+}
+
+bool DeviceSession::RunCommand(const vector<string>& arguments)
+{
+	if (arguments.empty())
+		return (true);
+
+	const string& command = arguments[0];
+
+	if (command == "end-session" || command == "close-pc-screen")
+	{
+		bool reboot = true;
+
+		for (unsigned int i = 1; i < arguments.size(); i++)
+		{
+			if (arguments[i] == "--no-reboot")
+			{
+				reboot = false;
+			}
+			else
+			{
+				Interface::PrintError("Unknown %s argument: %s\n", command.c_str(), arguments[i].c_str());
+				return (false);
+			}
+		}
+
+		return (End(reboot));
+	}
+
+	if (!IsCommand(command))
+	{
+		Interface::PrintError("Unknown command: %s\n", command.c_str());
+		Interface::Print(commandUsage);
+		return (false);
+	}
+
+	if (!Begin())
+		return (false);
+
+	if (command == "print-pit")
+	{
+		if (arguments.size() != 1)
+		{
+			Interface::PrintError("print-pit doesn't take any arguments.\n");
+			return (false);
+		}
+
+		return (PrintPit());
+	}
+	else if (command == "download-pit")
+	{
+		if (arguments.size() != 2)
+		{
+			Interface::PrintError("download-pit expects a filename.\n");
+			return (false);
+		}
+
+		return (DownloadPit(arguments[1]));
+	}
+	else
+	{
+		return (Flash(arguments));
+	}
+}
@@ -0,0 +1,108 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef DEVICESESSION_H
+#define DEVICESESSION_H
+
+// C/C++ Standard Library
+#include <string>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "BridgeManager.h"
+
+namespace Heimdall
+{
+	// A session with a single device that is kept open across several operations, so that they needn't each
+	// initialise the device, begin a session and download the PIT. Operations are given as commands, e.g.
+	// "flash BOOT boot.img", so that they can be read from a script or a client connection.
+	class DeviceSession
+	{
+		private:
+
+			BridgeManager *bridgeManager;
+
+			bool resume;
+			bool initialised;
+			bool sessionOpen;
+			bool rebooted;
+			bool failed;
+
+			unsigned char *pitBuffer;
+			unsigned int pitFileSize;
+			libpit::PitData *pitData;
+
+			bool RequirePit(void);
+			void DiscardPit(void);
+
+			bool DownloadPit(const std::string& filename);
+			bool PrintPit(void);
+			bool Flash(const std::vector<std::string>& arguments);
+
+		public:
+
+			static const char *commandUsage;
+
+			// Takes ownership of the bridge manager, which should already be configured. If resume is true, the device
+			// is expected to have been left in download mode by an earlier session.
+			DeviceSession(BridgeManager *bridgeManager, bool resume);
+			~DeviceSession();
+
+			// Initialises the device if necessary and begins a session.
+			bool Begin(void);
+			bool End(bool reboot);
+
+			bool IsOpen(void) const
+			{
+				return (sessionOpen);
+			}
+
+			// Once the device has been rebooted there's nothing more that can be done with it.
+			bool HasRebooted(void) const
+			{
+				return (rebooted);
+			}
+
+			// Once communication with the device has failed (e.g. it's been disconnected), the device may be in any state,
+			// so the session should be discarded and a new one begun with a new bridge manager.
+			bool HasFailed(void) const
+			{
+				return (failed);
+			}
+
+			const BridgeManager *GetBridgeManager(void) const
+			{
+				return (bridgeManager);
+			}
+
+			// Splits a command line into arguments, honouring double quotes. Returns false if quotes are unbalanced.
+			static bool ParseCommand(const std::string& line, std::vector<std::string>& arguments);
+
+			static bool IsCommand(const std::string& command);
+
+			// Runs a command, beginning the session first if need be.
+			bool RunCommand(const std::vector<std::string>& arguments);
+	};
+}
+
+#endif
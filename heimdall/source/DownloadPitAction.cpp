@@ -33,7 +33,7 @@ using namespace Heimdall;
 
 const char *DownloadPitAction::usage = "Action: download-pit\n\
 Arguments: --output <filename> [--verbose] [--no-reboot] [--stdout-errors]\n\
-    [--usb-log-level <none/error/warning/debug>]\n\
+    [--usb-log-level <none/error/warning/debug>] [--no-delay]\n\
 Description: Downloads the connected device's PIT file to the specified\n\
     output file.\n\
 Note: --no-reboot causes the device to remain in download mode after the action\n\
@@ -50,6 +50,7 @@ int DownloadPitAction::Execute(int argc, char **argv)
 	argumentTypes["resume"] = kArgumentTypeFlag;
 	argumentTypes["verbose"] = kArgumentTypeFlag;
 	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["no-delay"] = kArgumentTypeFlag;
 	argumentTypes["usb-log-level"] = kArgumentTypeString;
 
 	Arguments arguments(argumentTypes);
@@ -76,6 +77,9 @@ int DownloadPitAction::Execute(int argc, char **argv)
 	if (arguments.GetArgument("stdout-errors") != nullptr)
 		Interface::SetStdoutErrors(true);
 
+	if (arguments.GetArgument("no-delay") != nullptr)
+		Interface::SetNoDelay(true);
+
 	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
 
 	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
@@ -115,7 +119,7 @@ int DownloadPitAction::Execute(int argc, char **argv)
 	// Info
 
 	Interface::PrintReleaseInfo();
-	Sleep(1000);
+	Interface::Pause(1000);
 
 	// Open output file
 
@@ -0,0 +1,221 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "Arguments.h"
+#include "BeginDumpPacket.h"
+#include "BridgeManager.h"
+#include "DumpAction.h"
+#include "DumpFileWriter.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *DumpAction::usage = "Action: dump\n\
+Arguments: --chip-type <NAND/RAM> --chip-id <integer> --output <filename>\n\
+    [--compress] [--verbose] [--no-reboot] [--stdout-errors]\n\
+    [--usb-log-level <none/error/warning/debug>] [--no-delay]\n\
+Description: Dumps the contents of the specified chip on the connected device\n\
+    to the output file. Data is written to the file as it's received.\n\
+Note: --compress writes an LZ4 frame (*.lz4), which may be flashed back as it\n\
+      is. The device's bootloader must support dumping, which most do not.\n\
+Note: --no-reboot causes the device to remain in download mode after the action\n\
+      is completed. If you wish to perform another action whilst remaining in\n\
+      download mode, then the following action must specify the --resume flag.\n";
+
+int DumpAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["chip-type"] = kArgumentTypeString;
+	argumentTypes["chip-id"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["output"] = kArgumentTypeString;
+	argumentTypes["compress"] = kArgumentTypeFlag;
+	argumentTypes["no-reboot"] = kArgumentTypeFlag;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["no-delay"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(DumpAction::usage);
+		return (0);
+	}
+
+	const StringArgument *chipTypeArgument = static_cast<const StringArgument *>(arguments.GetArgument("chip-type"));
+	const UnsignedIntegerArgument *chipIdArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("chip-id"));
+	const StringArgument *outputArgument = static_cast<const StringArgument *>(arguments.GetArgument("output"));
+
+	if (!chipTypeArgument || !chipIdArgument || !outputArgument)
+	{
+		Interface::Print("Chip type, chip ID and output file must all be specified.\n\n");
+		Interface::Print(DumpAction::usage);
+		return (0);
+	}
+
+	unsigned int chipType;
+	const string& chipTypeString = chipTypeArgument->GetValue();
+
+	if (chipTypeString.compare("nand") == 0 || chipTypeString.compare("NAND") == 0)
+	{
+		chipType = BeginDumpPacket::kChipTypeNand;
+	}
+	else if (chipTypeString.compare("ram") == 0 || chipTypeString.compare("RAM") == 0)
+	{
+		chipType = BeginDumpPacket::kChipTypeRam;
+	}
+	else
+	{
+		Interface::Print("Unknown chip type: %s\n\n", chipTypeString.c_str());
+		Interface::Print(DumpAction::usage);
+		return (0);
+	}
+
+	bool compress = arguments.GetArgument("compress") != nullptr;
+	bool reboot = arguments.GetArgument("no-reboot") == nullptr;
+	bool resume = arguments.GetArgument("resume") != nullptr;
+	bool verbose = arguments.GetArgument("verbose") != nullptr;
+	
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	if (arguments.GetArgument("no-delay") != nullptr)
+		Interface::SetNoDelay(true);
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(DumpAction::usage);
+			return (0);
+		}
+	}
+
+	// Info
+
+	Interface::PrintReleaseInfo();
+	Interface::Pause(1000);
+
+	// Open output file
+
+	const char *outputFilename = outputArgument->GetValue().c_str();
+	FILE *outputFile = FileOpen(outputFilename, "wb");
+
+	if (!outputFile)
+	{
+		Interface::PrintError("Failed to open output file \"%s\"\n", outputFilename);
+		return (1);
+	}
+
+	// Dump from device.
+
+	BridgeManager *bridgeManager = new BridgeManager(verbose);
+	bridgeManager->SetUsbLogLevel(usbLogLevel);
+
+	if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
+	{
+		FileClose(outputFile);
+		delete bridgeManager;
+
+		return (1);
+	}
+
+	Interface::Print("Dumping %s chip %u...\n", (chipType == BeginDumpPacket::kChipTypeNand) ? "NAND" : "RAM",
+		chipIdArgument->GetValue());
+
+	DumpFileWriter *writer = new DumpFileWriter(outputFile, compress);
+
+	unsigned long long startTime = Utility::GetMilliseconds();
+	bool success = bridgeManager->ReceiveDump(chipType, chipIdArgument->GetValue(), writer);
+
+	if (success && !writer->Finish())
+	{
+		Interface::PrintError("Failed to write dump to output file!\n");
+		success = false;
+	}
+
+	if (success)
+	{
+		unsigned long long elapsed = Utility::GetMilliseconds() - startTime;
+		unsigned long long bytesWritten = writer->GetBytesWritten();
+
+		Interface::Print("Dumped %llu bytes in %llu ms (%.2f MB/s).\n", bytesWritten, elapsed,
+			(elapsed > 0) ? (double)bytesWritten / 1000.0 / (double)elapsed : 0.0);
+
+		if (compress)
+		{
+			unsigned long long compressedSize = FileTell(outputFile);
+
+			Interface::Print("Compressed to %llu bytes (%.1f%%).\n", compressedSize,
+				(bytesWritten > 0) ? 100.0 * (double)compressedSize / (double)bytesWritten : 100.0);
+		}
+
+		Interface::Print("\n");
+	}
+
+	delete writer;
+
+	if (!bridgeManager->EndSession(reboot))
+		success = false;
+
+	delete bridgeManager;
+	
+	FileClose(outputFile);
+
+	return (success ? 0 : 1);
+}
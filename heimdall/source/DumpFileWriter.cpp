@@ -0,0 +1,174 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Heimdall
+#include "DumpFileWriter.h"
+#include "Lz4FrameEncoder.h"
+#include "PacketBufferPool.h"
+
+using namespace std;
+using namespace Heimdall;
+
+DumpFileWriter::DumpFileWriter(FILE *file, bool compress, unsigned int bufferCount)
+{
+	this->file = file;
+	this->bufferCount = bufferCount;
+
+	encoder = (compress) ? new Lz4FrameEncoder(file) : nullptr;
+
+	buffersCommitted = 0;
+	buffersWritten = 0;
+	bytesWritten = 0;
+	writeFailed = false;
+	finishing = false;
+}
+
+DumpFileWriter::~DumpFileWriter()
+{
+	{
+		lock_guard<mutex> lock(bufferMutex);
+		finishing = true;
+	}
+
+	bufferCommittedCondition.notify_all();
+
+	if (writerThread.joinable())
+		writerThread.join();
+
+	delete encoder;
+
+	for (unsigned int i = 0; i < buffers.size(); i++)
+		PacketBufferPool::Release(buffers[i], kBufferSize);
+}
+
+void DumpFileWriter::WriteBuffers(void)
+{
+	for (unsigned int bufferIndex = 0; ; bufferIndex++)
+	{
+		unsigned int length;
+
+		{
+			unique_lock<mutex> lock(bufferMutex);
+
+			while (!finishing && bufferIndex == buffersCommitted)
+				bufferCommittedCondition.wait(lock);
+
+			if (bufferIndex == buffersCommitted)
+				return;
+
+			length = bufferLengths[bufferIndex % bufferCount];
+		}
+
+		// The buffer is exclusively ours until buffersWritten is incremented.
+		const unsigned char *buffer = buffers[bufferIndex % bufferCount];
+		bool success;
+
+		if (encoder)
+			success = encoder->Write(buffer, length);
+		else
+			success = fwrite(buffer, 1, length, file) == length;
+
+		{
+			lock_guard<mutex> lock(bufferMutex);
+
+			if (success)
+			{
+				buffersWritten++;
+				bytesWritten += length;
+			}
+			else
+			{
+				writeFailed = true;
+			}
+		}
+
+		bufferWrittenCondition.notify_one();
+
+		if (!success)
+			return;
+	}
+}
+
+bool DumpFileWriter::Start(unsigned long long dumpSize)
+{
+	if (encoder && !encoder->WriteHeader(dumpSize))
+		return (false);
+
+	buffers.resize(bufferCount);
+	bufferLengths.resize(bufferCount, 0);
+
+	for (unsigned int i = 0; i < bufferCount; i++)
+		buffers[i] = PacketBufferPool::Acquire(kBufferSize);
+
+	writerThread = thread(&DumpFileWriter::WriteBuffers, this);
+	return (true);
+}
+
+unsigned char *DumpFileWriter::AcquireBuffer(void)
+{
+	unique_lock<mutex> lock(bufferMutex);
+
+	while (buffersCommitted - buffersWritten >= bufferCount && !writeFailed)
+		bufferWrittenCondition.wait(lock);
+
+	if (writeFailed)
+		return (nullptr);
+
+	return (buffers[buffersCommitted % bufferCount]);
+}
+
+void DumpFileWriter::CommitBuffer(unsigned int length)
+{
+	{
+		lock_guard<mutex> lock(bufferMutex);
+
+		bufferLengths[buffersCommitted % bufferCount] = length;
+		buffersCommitted++;
+	}
+
+	bufferCommittedCondition.notify_one();
+}
+
+bool DumpFileWriter::Finish(void)
+{
+	{
+		lock_guard<mutex> lock(bufferMutex);
+		finishing = true;
+	}
+
+	bufferCommittedCondition.notify_all();
+
+	if (writerThread.joinable())
+		writerThread.join();
+
+	if (writeFailed)
+		return (false);
+
+	if (encoder && !encoder->Finish())
+		return (false);
+
+	return (fflush(file) == 0);
+}
+
+unsigned long long DumpFileWriter::GetBytesWritten(void)
+{
+	lock_guard<mutex> lock(bufferMutex);
+	return (bytesWritten);
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef DUMPFILEWRITER_H
+#define DUMPFILEWRITER_H
+
+// C/C++ Standard Library
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+namespace Heimdall
+{
+	class Lz4FrameEncoder;
+
+	// Writes a dump to a file on a background thread, from a ring of pre-allocated buffers that the device's data is
+	// received straight into, so that writing (and compressing) overlaps with receiving the next parts over USB.
+	class DumpFileWriter
+	{
+		public:
+
+			enum
+			{
+				kDefaultBufferCount = 8,
+
+				// A whole number of 500 byte dump parts.
+				kBufferSize = 1024000
+			};
+
+		private:
+
+			FILE *file;
+
+			// Compresses the dump into an LZ4 frame as it's written, if compression was requested.
+			Lz4FrameEncoder *encoder;
+
+			unsigned int bufferCount;
+			std::vector<unsigned char *> buffers;
+			std::vector<unsigned int> bufferLengths;
+
+			std::mutex bufferMutex;
+			std::condition_variable bufferCommittedCondition;
+			std::condition_variable bufferWrittenCondition;
+
+			unsigned int buffersCommitted;
+			unsigned int buffersWritten;
+			unsigned long long bytesWritten;
+			bool writeFailed;
+			bool finishing;
+
+			std::thread writerThread;
+
+			void WriteBuffers(void);
+
+		public:
+
+			DumpFileWriter(FILE *file, bool compress, unsigned int bufferCount = kDefaultBufferCount);
+			~DumpFileWriter();
+
+			// Must be called once the size of the dump is known, before any buffers are acquired.
+			bool Start(unsigned long long dumpSize);
+
+			// Returns the next free buffer (of GetBufferSize() bytes), waiting for one to be written if need be. Returns
+			// nullptr if writing has failed.
+			unsigned char *AcquireBuffer(void);
+
+			// Queues the buffer last acquired to be written.
+			void CommitBuffer(unsigned int length);
+
+			// Waits for all committed buffers to be written. Returns false if any of them couldn't be.
+			bool Finish(void);
+
+			unsigned int GetBufferSize(void) const
+			{
+				return (kBufferSize);
+			}
+
+			unsigned long long GetBytesWritten(void);
+	};
+}
+
+#endif
@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class DumpPartFileTransferPacket : public FileTransferPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<FileTransferPacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		private:
 
 			unsigned int partIndex;
@@ -44,11 +50,11 @@ namespace Heimdall
 				return (partIndex);
 			}
 
-			virtual void Pack(void)
+			void Pack(void)
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, partIndex);
+				Layout::Pack(data, partIndex);
 			}
 	};
 }
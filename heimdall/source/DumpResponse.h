@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class DumpResponse : public ResponsePacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<ResponsePacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ResponsePacket::kSize, "Packet fields exceed the packet size");
+
 		private:
 
 			unsigned int dumpSize;
@@ -48,7 +54,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				dumpSize = UnpackInteger(ResponsePacket::kDataSize);
+				Layout::Unpack(data, dumpSize);
 				
 				return (true);
 			}
@@ -38,9 +38,13 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::PackedLayout<FileTransferPacket::kDataSize, unsigned int, unsigned int, unsigned int, unsigned int> Layout;
+
+			static_assert(Layout::kOffset == 8 && Layout::kEnd == 24, "End file transfer fields must occupy bytes 8 to 23");
+
 			enum
 			{
-				kDataSize = FileTransferPacket::kDataSize + 16
+				kDataSize = Layout::kEnd
 			};
 
 		private:
@@ -83,14 +87,11 @@ namespace Heimdall
 				return (deviceType);
 			}
 
-			virtual void Pack(void)
+			void Pack(void)
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, destination);
-				PackInteger(FileTransferPacket::kDataSize + 4, sequenceByteCount);
-				PackInteger(FileTransferPacket::kDataSize + 8, unknown1);
-				PackInteger(FileTransferPacket::kDataSize + 12, deviceType);
+				Layout::Pack(data, destination, sequenceByteCount, unknown1, deviceType);
 			}
 	};
 }
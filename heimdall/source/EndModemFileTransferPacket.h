@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class EndModemFileTransferPacket : public EndFileTransferPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<EndFileTransferPacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		private:
 
 			unsigned int endOfFile;
@@ -49,7 +55,7 @@ namespace Heimdall
 			{
 				EndFileTransferPacket::Pack();
 
-				PackInteger(EndFileTransferPacket::kDataSize, endOfFile);
+				Layout::Pack(data, endOfFile);
 			}
 	};
 }
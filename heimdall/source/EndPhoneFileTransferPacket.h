@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class EndPhoneFileTransferPacket : public EndFileTransferPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<EndFileTransferPacket::kDataSize, unsigned int, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		public:
 
 			/*enum
@@ -79,8 +85,7 @@ namespace Heimdall
 			{
 				EndFileTransferPacket::Pack();
 
-				PackInteger(EndFileTransferPacket::kDataSize, fileIdentifier);
-				PackInteger(EndFileTransferPacket::kDataSize + 4, endOfFile);
+				Layout::Pack(data, fileIdentifier, endOfFile);
 			}
 	};
 }
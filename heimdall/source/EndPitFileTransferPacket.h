@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class EndPitFileTransferPacket : public PitFilePacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<PitFilePacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		private:
 
 			unsigned int fileSize;
@@ -48,7 +54,7 @@ namespace Heimdall
 			{
 				PitFilePacket::Pack();
 
-				PackInteger(PitFilePacket::kDataSize, fileSize);
+				Layout::Pack(data, fileSize);
 			}
 	};
 }
@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class EndSessionPacket : public ControlPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<ControlPacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		public:
 
 			enum
@@ -56,7 +62,7 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				Layout::Pack(data, request);
 			}
 	};
 }
@@ -0,0 +1,94 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// libpit
+#include "PackedLayout.h"
+
+// Heimdall
+#include "FileDecoder.h"
+#include "Lz4FrameDecoder.h"
+#include "SparseImageDecoder.h"
+
+using namespace Heimdall;
+
+bool FileDecoder::expandSparseImages = false;
+
+bool FileDecoder::Open(FILE *file, unsigned long long offset, ArchiveVerifier *verifier, FileDecoder **decoder)
+{
+	*decoder = nullptr;
+
+	if (Lz4FrameDecoder::IsLz4File(file, offset))
+	{
+		Lz4FrameDecoder *lz4Decoder = new Lz4FrameDecoder(file, offset, verifier);
+		bool sparseImage = false;
+
+		if (!lz4Decoder->ReadHeader())
+		{
+			delete lz4Decoder;
+			return (false);
+		}
+
+		// Samsung's compressed system images are usually sparse images, which can only be recognised by decompressing
+		// the start of them. The frame is then started over.
+		if (expandSparseImages && lz4Decoder->GetContentSize() >= SparseImageDecoder::kHeaderSize)
+		{
+			unsigned char magicNumber[4];
+
+			if (!lz4Decoder->Read(magicNumber, 4) || !lz4Decoder->ReadHeader())
+			{
+				delete lz4Decoder;
+				return (false);
+			}
+
+			sparseImage = libpit::PackedField<unsigned int>::Load(magicNumber) == SparseImageDecoder::kMagicNumber;
+		}
+
+		if (!sparseImage)
+		{
+			*decoder = lz4Decoder;
+			return (true);
+		}
+
+		*decoder = new SparseImageDecoder(file, offset, verifier, lz4Decoder);
+	}
+	else if (expandSparseImages && SparseImageDecoder::IsSparseFile(file, offset))
+	{
+		*decoder = new SparseImageDecoder(file, offset, verifier);
+	}
+	else
+	{
+		return (true);
+	}
+
+	if (!(*decoder)->ReadHeader())
+	{
+		delete *decoder;
+		*decoder = nullptr;
+
+		return (false);
+	}
+
+	return (true);
+}
+
+bool FileDecoder::IsEncoded(FILE *file, unsigned long long offset)
+{
+	return (Lz4FrameDecoder::IsLz4File(file, offset) || (expandSparseImages && SparseImageDecoder::IsSparseFile(file, offset)));
+}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef FILEDECODER_H
+#define FILEDECODER_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+namespace Heimdall
+{
+	class ArchiveVerifier;
+
+	// Decodes a file's data as it's read, e.g. decompressing it, so that it needn't be decoded to disk beforehand.
+	class FileDecoder
+	{
+		private:
+
+			static bool expandSparseImages;
+
+		public:
+
+			virtual ~FileDecoder()
+			{
+			}
+
+			// Samsung's bootloaders accept Android sparse images, so they're sent as they are unless expanding them is
+			// enabled. Must be set before any files are opened.
+			static void SetExpandSparseImages(bool expandSparseImages)
+			{
+				FileDecoder::expandSparseImages = expandSparseImages;
+			}
+
+			static bool GetExpandSparseImages(void)
+			{
+				return (expandSparseImages);
+			}
+
+			// Creates a decoder for the data at offset within the file and reads its header. LZ4 compressed files are
+			// decoded, as are Android sparse images (LZ4 compressed or not) if expanding them is enabled. decoder is set to
+			// nullptr if the data is to be sent as is. The data read from the file is fed to verifier, if one is given.
+			static bool Open(FILE *file, unsigned long long offset, ArchiveVerifier *verifier, FileDecoder **decoder);
+
+			// Whether the data at offset within the file needs decoding, leaving the file rewound.
+			static bool IsEncoded(FILE *file, unsigned long long offset = 0);
+
+			// Reads the header, which records the size of the decoded data.
+			virtual bool ReadHeader(void) = 0;
+			virtual unsigned long long GetContentSize(void) const = 0;
+
+			// Decodes exactly length bytes into the buffer.
+			virtual bool Read(unsigned char *buffer, unsigned int length) = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,184 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+// Heimdall
+#include "ArchiveVerifier.h"
+#include "FileDecoder.h"
+#include "FilePartReader.h"
+#include "Heimdall.h"
+#include "PacketBufferPool.h"
+
+using namespace std;
+using namespace Heimdall;
+
+FilePartReader::FilePartReader(FILE *file, unsigned long long offset, unsigned long long length, ArchiveVerifier *verifier,
+	unsigned int bufferCount)
+{
+	this->file = file;
+	this->verifier = verifier;
+	this->bufferCount = bufferCount;
+
+	dataOffset = offset;
+
+	readFailed = !FileDecoder::Open(file, offset, verifier, &decoder);
+
+	if (decoder)
+	{
+		fileSize = decoder->GetContentSize();
+	}
+	else
+	{
+		fileSize = GetRegionLength(file, offset, length);
+		FileSeek(file, offset, SEEK_SET);
+	}
+
+	partSize = 0;
+	partCount = 0;
+
+	partsRead = 0;
+	partsReleased = 0;
+	stopping = false;
+}
+
+FilePartReader::~FilePartReader()
+{
+	{
+		lock_guard<mutex> lock(partMutex);
+		stopping = true;
+	}
+
+	partReleasedCondition.notify_all();
+
+	if (readerThread.joinable())
+		readerThread.join();
+
+	delete decoder;
+
+	for (unsigned int i = 0; i < buffers.size(); i++)
+		PacketBufferPool::Release(buffers[i], partSize);
+}
+
+void FilePartReader::ReadParts(void)
+{
+	unsigned long long bytesRemaining = fileSize;
+	unsigned long long position = dataOffset;
+
+	for (unsigned int partIndex = 0; partIndex < partCount; partIndex++)
+	{
+		{
+			unique_lock<mutex> lock(partMutex);
+
+			while (!stopping && partIndex - partsReleased >= bufferCount)
+				partReleasedCondition.wait(lock);
+
+			if (stopping)
+				return;
+		}
+
+		// The buffer is exclusively ours until partsRead is incremented.
+		unsigned char *buffer = buffers[partIndex % bufferCount];
+		unsigned int bytesToRead = (bytesRemaining < partSize) ? (unsigned int)bytesRemaining : partSize;
+
+		if (bytesToRead < partSize)
+			memset(buffer + bytesToRead, 0, partSize - bytesToRead);
+
+		bool success;
+
+		if (decoder)
+		{
+			success = decoder->Read(buffer, bytesToRead);
+		}
+		else
+		{
+			success = fread(buffer, 1, bytesToRead, file) == bytesToRead;
+
+			if (success && verifier)
+				verifier->Feed(position, buffer, bytesToRead);
+
+			position += bytesToRead;
+		}
+
+		bytesRemaining -= bytesToRead;
+
+		{
+			lock_guard<mutex> lock(partMutex);
+
+			if (success)
+				partsRead++;
+			else
+				readFailed = true;
+		}
+
+		partReadCondition.notify_one();
+
+		if (!success)
+			return;
+	}
+}
+
+bool FilePartReader::Start(unsigned int partSize)
+{
+	if (readFailed)
+		return (false);
+
+	this->partSize = partSize;
+
+	partCount = (unsigned int)((fileSize + partSize - 1) / partSize);
+
+	if (bufferCount > partCount)
+		bufferCount = (partCount > 0) ? partCount : 1;
+
+	buffers.resize(bufferCount);
+
+	for (unsigned int i = 0; i < bufferCount; i++)
+		buffers[i] = PacketBufferPool::Acquire(partSize);
+
+	readerThread = thread(&FilePartReader::ReadParts, this);
+	return (true);
+}
+
+unsigned char *FilePartReader::AcquirePart(void)
+{
+	unique_lock<mutex> lock(partMutex);
+
+	if (partsReleased == partCount)
+		return (nullptr);
+
+	while (partsRead == partsReleased && !readFailed)
+		partReadCondition.wait(lock);
+
+	if (partsRead == partsReleased)
+		return (nullptr);
+
+	return (buffers[partsReleased % bufferCount]);
+}
+
+void FilePartReader::ReleasePart(void)
+{
+	{
+		lock_guard<mutex> lock(partMutex);
+		partsReleased++;
+	}
+
+	partReleasedCondition.notify_one();
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef FILEPARTREADER_H
+#define FILEPARTREADER_H
+
+// C/C++ Standard Library
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// Heimdall
+#include "FilePartSource.h"
+
+namespace Heimdall
+{
+	// Reads a file on a background thread into a ring of pre-allocated part buffers, so that reading the next parts
+	// from disk overlaps with sending the current part over USB.
+	class ArchiveVerifier;
+	class FileDecoder;
+
+	class FilePartReader : public FilePartSource
+	{
+		public:
+
+			enum
+			{
+				kDefaultBufferCount = 4
+			};
+
+		private:
+
+			FILE *file;
+			unsigned long long dataOffset;
+			unsigned long long fileSize;
+
+			// Decodes LZ4 compressed files and sparse images as they're read.
+			FileDecoder *decoder;
+
+			// Data is fed to the verifier (if any) as it's read from the file.
+			ArchiveVerifier *verifier;
+			unsigned int partSize;
+			unsigned int partCount;
+
+			unsigned int bufferCount;
+			std::vector<unsigned char *> buffers;
+
+			std::mutex partMutex;
+			std::condition_variable partReadCondition;
+			std::condition_variable partReleasedCondition;
+
+			unsigned int partsRead;
+			unsigned int partsReleased;
+			bool readFailed;
+			bool stopping;
+
+			std::thread readerThread;
+
+			void ReadParts(void);
+
+		public:
+
+			FilePartReader(FILE *file, unsigned long long offset = 0, unsigned long long length = kToEndOfFile,
+				ArchiveVerifier *verifier = nullptr, unsigned int bufferCount = kDefaultBufferCount);
+			~FilePartReader();
+
+			unsigned long long GetSize(void) const
+			{
+				return (fileSize);
+			}
+
+			bool Start(unsigned int partSize);
+
+			unsigned char *AcquirePart(void);
+			void ReleasePart(void);
+	};
+}
+
+#endif
@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class FilePartSizePacket : public SessionSetupPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<SessionSetupPacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		private:
 
 			unsigned int filePartSize;
@@ -48,7 +54,7 @@ namespace Heimdall
 			{
 				SessionSetupPacket::Pack();
 
-				PackInteger(SessionSetupPacket::kDataSize, filePartSize);
+				Layout::Pack(data, filePartSize);
 			}
 	};
 }
@@ -0,0 +1,71 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Heimdall
+#include "FileDecoder.h"
+#include "FilePartReader.h"
+#include "FilePartSource.h"
+#include "Heimdall.h"
+#include "MappedFilePartSource.h"
+
+using namespace Heimdall;
+
+FilePartSource *FilePartSource::Create(FILE *file, unsigned long long offset, unsigned long long length, ArchiveVerifier *verifier)
+{
+	if (!FileDecoder::IsEncoded(file, offset) && MappedFilePartSource::IsMappable(file))
+		return (new MappedFilePartSource(file, offset, length, verifier));
+	else
+		return (new FilePartReader(file, offset, length, verifier));
+}
+
+bool FilePartSource::GetDataSize(FILE *file, unsigned long long *dataSize, unsigned long long offset, unsigned long long length)
+{
+	FileDecoder *decoder;
+
+	if (!FileDecoder::Open(file, offset, nullptr, &decoder))
+	{
+		FileRewind(file);
+		return (false);
+	}
+
+	if (decoder)
+	{
+		*dataSize = decoder->GetContentSize();
+		delete decoder;
+
+		FileRewind(file);
+		return (true);
+	}
+
+	*dataSize = GetRegionLength(file, offset, length);
+	return (true);
+}
+
+unsigned long long FilePartSource::GetRegionLength(FILE *file, unsigned long long offset, unsigned long long length)
+{
+	if (length != kToEndOfFile)
+		return (length);
+
+	FileSeek(file, 0, SEEK_END);
+	unsigned long long fileSize = (unsigned long long)FileTell(file);
+	FileRewind(file);
+
+	return ((fileSize > offset) ? fileSize - offset : 0);
+}
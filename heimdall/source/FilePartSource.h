@@ -0,0 +1,70 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef FILEPARTSOURCE_H
+#define FILEPARTSOURCE_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+namespace Heimdall
+{
+	class ArchiveVerifier;
+
+	// Supplies the contents of a file to BridgeManager::SendFile() as a series of equally sized file parts.
+	class FilePartSource
+	{
+		public:
+
+			// Sources may cover just a region of a file (e.g. a member of an archive), given by an offset and length.
+			static const unsigned long long kToEndOfFile = ~0ULL;
+
+			virtual ~FilePartSource()
+			{
+			}
+
+			// Creates the most suitable source for the file. Regular files are sent straight from a memory mapping,
+			// anything else (e.g. a pipe) is read on a separate thread. LZ4 compressed files and sparse images are
+			// decoded on a separate thread as they're read. The data read is also fed to verifier, if one is given.
+			static FilePartSource *Create(FILE *file, unsigned long long offset = 0, unsigned long long length = kToEndOfFile,
+				ArchiveVerifier *verifier = nullptr);
+
+			// Retrieves the number of bytes a source would deliver for the file, i.e. the uncompressed size of LZ4
+			// compressed files and the expanded size of sparse images.
+			static bool GetDataSize(FILE *file, unsigned long long *dataSize, unsigned long long offset = 0,
+				unsigned long long length = kToEndOfFile);
+
+			// Resolves a length of kToEndOfFile to the number of bytes from offset to the end of the file.
+			static unsigned long long GetRegionLength(FILE *file, unsigned long long offset, unsigned long long length);
+
+			// Number of bytes of file data, excluding the padding of the final part.
+			virtual unsigned long long GetSize(void) const = 0;
+
+			// Prepares the source to deliver parts of the specified size, the final part is padded with zeros.
+			virtual bool Start(unsigned int partSize) = 0;
+
+			// Blocks until the next part is available. The same part is returned until ReleasePart() is called, so a
+			// part can be resent. Returns nullptr if the part could not be read.
+			virtual unsigned char *AcquirePart(void) = 0;
+			virtual void ReleasePart(void) = 0;
+	};
+}
+
+#endif
@@ -40,9 +40,13 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::PackedLayout<ControlPacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 			enum
 			{
-				kDataSize = ControlPacket::kDataSize + 4
+				kDataSize = Layout::kEnd
 			};
 
 		private:
@@ -61,11 +65,11 @@ namespace Heimdall
 				return (request);
 			}
 
-			virtual void Pack(void)
+			void Pack(void)
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				Layout::Pack(data, request);
 			}
 	};
 }
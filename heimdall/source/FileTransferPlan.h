@@ -0,0 +1,96 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef FILETRANSFERPLAN_H
+#define FILETRANSFERPLAN_H
+
+namespace Heimdall
+{
+	// Describes how a file is split into fixed size file parts, which are in turn grouped into sequences. Sizes are
+	// 64-bit as partition images are frequently larger than 4 GiB, however a single sequence never is.
+	class FileTransferPlan
+	{
+		private:
+
+			unsigned long long fileSize;
+			unsigned int partSize;
+			unsigned int sequenceMaxLength;
+
+			unsigned int partCount;
+			unsigned int sequenceCount;
+
+		public:
+
+			FileTransferPlan(unsigned long long fileSize, unsigned int partSize, unsigned int sequenceMaxLength)
+			{
+				this->fileSize = fileSize;
+				this->partSize = partSize;
+				this->sequenceMaxLength = sequenceMaxLength;
+
+				partCount = (unsigned int)((fileSize + partSize - 1) / partSize);
+				sequenceCount = (partCount + sequenceMaxLength - 1) / sequenceMaxLength;
+			}
+
+			unsigned long long GetFileSize(void) const
+			{
+				return (fileSize);
+			}
+
+			unsigned int GetPartSize(void) const
+			{
+				return (partSize);
+			}
+
+			unsigned int GetPartCount(void) const
+			{
+				return (partCount);
+			}
+
+			unsigned int GetSequenceCount(void) const
+			{
+				return (sequenceCount);
+			}
+
+			// Number of file parts in the specified sequence. Only the last sequence may be shorter than the maximum.
+			unsigned int GetSequenceLength(unsigned int sequenceIndex) const
+			{
+				unsigned int remainingParts = partCount - sequenceIndex * sequenceMaxLength;
+				return ((remainingParts < sequenceMaxLength) ? remainingParts : sequenceMaxLength);
+			}
+
+			// Number of bytes of the file in a run of parts i.e. excluding the padding of the final part.
+			unsigned long long GetByteCount(unsigned int firstPartIndex, unsigned int partCount) const
+			{
+				unsigned long long offset = (unsigned long long)firstPartIndex * partSize;
+				unsigned long long remainingBytes = fileSize - offset;
+				unsigned long long byteCount = (unsigned long long)partCount * partSize;
+
+				return ((remainingBytes < byteCount) ? remainingBytes : byteCount);
+			}
+
+			// Number of bytes of the file in the specified sequence.
+			unsigned int GetSequenceByteCount(unsigned int sequenceIndex) const
+			{
+				return ((unsigned int)GetByteCount(sequenceIndex * sequenceMaxLength, GetSequenceLength(sequenceIndex)));
+			}
+	};
+}
+
+#endif
@@ -18,70 +18,300 @@
  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  THE SOFTWARE.*/
 
-// C Standard Library
+// C/C++ Standard Library
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <signal.h>
 #include <stdio.h>
+#include <thread>
 
 // Heimdall
+#include "ArchiveVerifier.h"
 #include "Arguments.h"
 #include "BridgeManager.h"
 #include "EnableTFlashPacket.h"
 #include "EndModemFileTransferPacket.h"
 #include "EndPhoneFileTransferPacket.h"
+#include "FileDecoder.h"
+#include "FilePartSource.h"
+#include "FileTransferPlan.h"
 #include "FlashAction.h"
+#include "FlashJournal.h"
+#include "FlashLedger.h"
 #include "Heimdall.h"
 #include "Interface.h"
+#include "PacketBufferPool.h"
+#include "PitCache.h"
 #include "SessionSetupResponse.h"
+#include "SharedFilePartReader.h"
+#include "StationAction.h"
+#include "TarArchive.h"
 #include "TotalBytesPacket.h"
 #include "Utility.h"
+#include "XxHash.h"
 
 using namespace std;
 using namespace libpit;
 using namespace Heimdall;
 
+// Enough for the first few parts of each file, at the default part size.
+static const unsigned int kPrefetchSize = 4194304;
+
+// The block counts of MMC partitions are in sectors.
+static const unsigned int kMmcSectorSize = 512;
+
+// Typical of download mode over USB 2, used to predict how long a flash will take unless --throughput is given.
+static const unsigned int kThroughputEstimateDefault = 20; // MiB/s
+
 const char *FlashAction::usage = "Action: flash\n\
 Arguments:\n\
     [--<partition name> <filename> ...]\n\
     [--<partition identifier> <filename> ...]\n\
+    [--archive <filename>[,<filename>...]]\n\
     [--pit <filename>] [--verbose] [--no-reboot] [--resume] [--stdout-errors]\n\
-    [--usb-log-level <none/error/warning/debug>]\n\
+    [--usb-log-level <none/error/warning/debug>] [--usb-transfer-mode <sync/async>]\n\
+    [--autotune] [--calibrate-empty-transfers] [--no-pit-cache] [--no-delay]\n\
+    [--skip-unchanged] [--all-devices | --devices <bus:port>[,<bus:port>...]]\n\
+    [--journal <filename> | --resume-journal <filename>]\n\
+    [--expand-sparse] [--throughput <MiB/s>]\n\
   or:\n\
     --repartition --pit <filename> [--<partition name> <filename> ...]\n\
-    [--<partition identifier> <filename> ...] [--verbose] [--no-reboot]\n\
+    [--<partition identifier> <filename> ...]\n\
+    [--archive <filename>[,<filename>...]] [--verbose] [--no-reboot]\n\
     [--resume] [--stdout-errors] [--usb-log-level <none/error/warning/debug>]\n\
-    [--tflash]\n\
+    [--usb-transfer-mode <sync/async>] [--autotune]\n\
+    [--calibrate-empty-transfers] [--tflash] [--no-delay]\n\
+    [--all-devices | --devices <bus:port>[,<bus:port>...]]\n\
+    [--expand-sparse] [--throughput <MiB/s>]\n\
+  or:\n\
+    --dry-run --pit <filename> [--repartition]\n\
+    [--<partition name> <filename> ...]\n\
+    [--<partition identifier> <filename> ...]\n\
+    [--archive <filename>[,<filename>...]] [--expand-sparse]\n\
+    [--throughput <MiB/s>]\n\
 Description: Flashes one or more firmware files to your phone. Partition names\n\
     (or identifiers) can be obtained by executing the print-pit action.\n\
     T-Flash mode allows to flash the inserted SD-card instead of the internal MMC.\n\
+    LZ4 compressed files are decompressed as they're flashed, and files are\n\
+    checked against the sizes of MMC partitions before any are sent.\n\
+    --archive flashes the members of tar archives (e.g. .tar.md5 files).\n\
+    --usb-transfer-mode async queues several USB transfers per file part.\n\
+    --autotune finds and remembers the fastest part size and sequence length.\n\
+    --calibrate-empty-transfers skips empty USB transfers the device ignores.\n\
+    --no-pit-cache always downloads the device's PIT rather than a cached copy.\n\
+    --skip-unchanged skips partitions Heimdall last flashed with the same file.\n\
+    --all-devices / --devices flash several connected devices at once.\n\
+    --journal / --resume-journal allow an interrupted flash to be continued.\n\
+    --expand-sparse expands Android sparse images as they're flashed.\n\
+    --dry-run prints the transfer plan without connecting to a device.\n\
+    --throughput sets the speed (MiB/s) the dry run's estimate is based on.\n\
+    --no-delay skips the pauses that give you time to read messages.\n\
+    See README.md for details of these options.\n\
 Note: --no-reboot causes the device to remain in download mode after the action\n\
       is completed. If you wish to perform another action whilst remaining in\n\
       download mode, then the following action must specify the --resume flag.\n\
 WARNING: If you're repartitioning it's strongly recommended you specify\n\
         all files at your disposal.\n";
 
+// The results of preparing a file for flashing, which doesn't involve the device.
+struct PreparedFile
+{
+	unsigned long long dataSize;
+
+	// Hash of the file's contents (as stored, i.e. before decompression) and of whether sparse images are expanded, only
+	// calculated when skipping unchanged partitions or journalling.
+	unsigned long long contentHash;
+
+	PreparedFile()
+	{
+		dataSize = 0;
+		contentHash = 0;
+	}
+};
+
 struct PartitionFile
 {
 	const char *argumentName;
+	string filename;
 	FILE *file;
 
-	PartitionFile(const char *argumentName, FILE *file)
+	// Archive members have no argument name. They're flashed to the partition with a matching flash filename, and are
+	// read from their region of the archive.
+	string memberName;
+	unsigned long long offset;
+	unsigned long long length;
+
+	// Members of a .tar.md5 archive share the verifier of its checksum.
+	shared_ptr<ArchiveVerifier> verifier;
+
+	// When flashing several devices, file parts are read once and shared between them.
+	SharedFilePartReader *sharedReader;
+	unsigned int consumer;
+
+	// Available once the files have been prepared.
+	const PreparedFile *prepared;
+
+	PartitionFile(const char *argumentName, const string& filename, FILE *file)
 	{
 		this->argumentName = argumentName;
+		this->filename = filename;
+		this->file = file;
+
+		offset = 0;
+		length = FilePartSource::kToEndOfFile;
+
+		sharedReader = nullptr;
+		consumer = 0;
+
+		prepared = nullptr;
+	}
+
+	PartitionFile(const TarMember& member, const string& archiveFilename, FILE *file)
+	{
+		argumentName = nullptr;
+		filename = archiveFilename;
 		this->file = file;
+
+		memberName = member.name;
+		offset = member.offset;
+		length = member.size;
+
+		sharedReader = nullptr;
+		consumer = 0;
+
+		prepared = nullptr;
+	}
+};
+
+// Files are checked (e.g. that compressed files can be decompressed), sized and hashed on worker threads whilst the
+// device's session is set up. Each worker opens its file separately, so the files being flashed aren't disturbed.
+struct FilePreparation
+{
+	vector<PreparedFile> preparedFiles;
+	vector<char> results;
+	vector<thread> workers;
+
+	once_flag finishFlag;
+	bool succeeded;
+
+	bool verbose;
+	unsigned long long startTime;
+
+	FilePreparation(bool verbose)
+	{
+		succeeded = false;
+
+		this->verbose = verbose;
+		startTime = 0;
+	}
+
+	~FilePreparation()
+	{
+		Finish();
 	}
+
+	void Start(vector<PartitionFile>& partitionFiles, bool hash);
+
+	// Waits for every file to be prepared. Returns false if any of them couldn't be.
+	bool Finish(void);
+};
+
+struct FlashOptions
+{
+	bool reboot;
+	bool resume;
+	bool verbose;
+	bool tflash;
+	bool autotune;
+	bool calibrateEmptyTransfers;
+	bool usePitCache;
+	bool repartition;
+	bool skipUnchanged;
+
+	// In MiB/s, used to predict how long the transfer will take.
+	unsigned int throughput;
+
+	BridgeManager::UsbLogLevel usbLogLevel;
+	BridgeManager::UsbTransferMode usbTransferMode;
 };
 
 struct PartitionFlashInfo
 {
 	const PitEntry *pitEntry;
-	FILE *file;
+	const PartitionFile *partitionFile;
 
-	PartitionFlashInfo(const PitEntry *pitEntry, FILE *file)
+	PartitionFlashInfo(const PitEntry *pitEntry, const PartitionFile *partitionFile)
 	{
 		this->pitEntry = pitEntry;
-		this->file = file;
+		this->partitionFile = partitionFile;
 	}
 };
 
+static void splitList(const string& list, vector<string>& items)
+{
+	size_t start = 0;
+
+	while (start <= list.length())
+	{
+		size_t end = list.find(',', start);
+
+		if (end == string::npos)
+			end = list.length();
+
+		if (end > start)
+			items.push_back(list.substr(start, end - start));
+
+		start = end + 1;
+	}
+}
+
+static bool openArchive(const string& archiveFilename, vector<PartitionFile>& partitionFiles)
+{
+	FILE *archiveFile = FileOpen(archiveFilename.c_str(), "rb");
+
+	if (!archiveFile)
+	{
+		Interface::PrintError("Failed to open file \"%s\"\n", archiveFilename.c_str());
+		return (false);
+	}
+
+	vector<TarMember> members;
+	bool success = TarArchive::ReadMembers(archiveFile, members);
+
+	FileClose(archiveFile);
+
+	if (!success)
+	{
+		Interface::PrintError("Failed to read archive \"%s\"\n", archiveFilename.c_str());
+		return (false);
+	}
+
+	shared_ptr<ArchiveVerifier> verifier(ArchiveVerifier::Create(archiveFilename));
+
+	// Each member has the archive open separately, so that they can be read independently of each other.
+	for (vector<TarMember>::const_iterator it = members.begin(); it != members.end(); it++)
+	{
+		if (it->size == 0)
+			continue;
+
+		FILE *file = FileOpen(archiveFilename.c_str(), "rb");
+
+		if (!file)
+		{
+			Interface::PrintError("Failed to open file \"%s\"\n", archiveFilename.c_str());
+			return (false);
+		}
+
+		partitionFiles.push_back(PartitionFile(*it, archiveFilename, file));
+		partitionFiles.back().verifier = verifier;
+	}
+
+	return (true);
+}
+
 static bool openFiles(Arguments& arguments, vector<PartitionFile>& partitionFiles, FILE *& pitFile)
 {
 	// Open PIT file
@@ -120,7 +350,23 @@ static bool openFiles(Arguments& arguments, vector<PartitionFile>& partitionFile
 				return (false);
 			}
 
-			partitionFiles.push_back(PartitionFile(argumentName.c_str(), file));
+			partitionFiles.push_back(PartitionFile(argumentName.c_str(), stringArgument->GetValue(), file));
+		}
+	}
+
+	// Open archives
+
+	const StringArgument *archiveArgument = static_cast<const StringArgument *>(arguments.GetArgument("archive"));
+
+	if (archiveArgument)
+	{
+		vector<string> archiveFilenames;
+		splitList(archiveArgument->GetValue(), archiveFilenames);
+
+		for (vector<string>::const_iterator it = archiveFilenames.begin(); it != archiveFilenames.end(); it++)
+		{
+			if (!openArchive(*it, partitionFiles))
+				return (false);
 		}
 	}
 
@@ -145,29 +391,140 @@ static void closeFiles(vector<PartitionFile>& partitionFiles, FILE *& pitFile)
 	partitionFiles.clear();
 }
 
-static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<PartitionFile>& partitionFiles, FILE *pitFile, bool repartition)
+static bool hasArchiveMembers(const vector<PartitionFile>& partitionFiles)
 {
-	unsigned int totalBytes = 0;
-
 	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
 	{
-		FileSeek(it->file, 0, SEEK_END);
-		totalBytes += (unsigned int)FileTell(it->file);
-		FileRewind(it->file);
+		if (!it->argumentName)
+			return (true);
+	}
+
+	return (false);
+}
+
+static bool prepareFile(const PartitionFile& partitionFile, bool hash, PreparedFile *preparedFile)
+{
+	FILE *file = FileOpen(partitionFile.filename.c_str(), "rb");
+	bool success = file != nullptr;
+
+	// Checks that compressed files can be decompressed, before anything is flashed.
+	if (success)
+		success = FilePartSource::GetDataSize(file, &preparedFile->dataSize, partitionFile.offset, partitionFile.length);
+
+	if (success)
+	{
+		// Hashing reads the whole file, otherwise just enough is read for the first parts to be cached by the time
+		// they're flashed.
+		unsigned long long bytesRemaining = FilePartSource::GetRegionLength(file, partitionFile.offset, partitionFile.length);
+
+		if (!hash && bytesRemaining > kPrefetchSize)
+			bytesRemaining = kPrefetchSize;
+
+		vector<unsigned char> buffer(1048576);
+		Xxh64 contentHash;
+
+		FileSeek(file, partitionFile.offset, SEEK_SET);
+
+		while (success && bytesRemaining > 0)
+		{
+			unsigned int bytesToRead = (bytesRemaining < buffer.size()) ? (unsigned int)bytesRemaining : (unsigned int)buffer.size();
+			success = fread(buffer.data(), 1, bytesToRead, file) == bytesToRead;
+
+			if (hash)
+				contentHash.Update(buffer.data(), bytesToRead);
+
+			bytesRemaining -= bytesToRead;
+		}
+
+		// The same sparse image is written differently depending on whether it's expanded, so the ledger and journal
+		// mustn't match it across modes.
+		if (hash)
+		{
+			unsigned char expandSparseImages = FileDecoder::GetExpandSparseImages() ? 1 : 0;
+			contentHash.Update(&expandSparseImages, 1);
+		}
+
+		preparedFile->contentHash = contentHash.GetDigest();
+	}
+
+	if (file)
+		FileClose(file);
+
+	if (!success)
+	{
+		if (partitionFile.argumentName)
+			Interface::PrintError("Failed to read file \"%s\"\n", partitionFile.filename.c_str());
+		else
+			Interface::PrintError("Failed to read \"%s\" in archive \"%s\"\n", partitionFile.memberName.c_str(), partitionFile.filename.c_str());
+	}
+
+	return (success);
+}
+
+void FilePreparation::Start(vector<PartitionFile>& partitionFiles, bool hash)
+{
+	startTime = Utility::GetMilliseconds();
+
+	preparedFiles.resize(partitionFiles.size());
+	results.resize(partitionFiles.size(), false);
+
+	for (unsigned int i = 0; i < partitionFiles.size(); i++)
+	{
+		partitionFiles[i].prepared = &preparedFiles[i];
+
+		PartitionFile partitionFile = partitionFiles[i];
+		workers.push_back(thread([this, partitionFile, hash, i]()
+		{
+			results[i] = prepareFile(partitionFile, hash, &preparedFiles[i]);
+		}));
 	}
+}
+
+bool FilePreparation::Finish(void)
+{
+	// Every device being flashed waits for the files, but only the first to do so joins the workers.
+	call_once(finishFlag, [this]()
+	{
+		unsigned long long waitStartTime = Utility::GetMilliseconds();
+
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+
+		succeeded = true;
+
+		for (unsigned int i = 0; i < results.size(); i++)
+			succeeded = succeeded && results[i];
+
+		if (verbose && !workers.empty())
+		{
+			unsigned long long endTime = Utility::GetMilliseconds();
+			Interface::Print("Files prepared in %llu ms, of which %llu ms was spent waiting for them\n", endTime - startTime,
+				endTime - waitStartTime);
+		}
+	});
+
+	return (succeeded);
+}
+
+static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<const PartitionFile *>& partitionFiles, FILE *pitFile,
+	bool repartition)
+{
+	unsigned long long totalBytes = 0;
+
+	for (vector<const PartitionFile *>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+		totalBytes += (*it)->prepared->dataSize;
 
 	if (repartition)
 	{
 		FileSeek(pitFile, 0, SEEK_END);
-		totalBytes += (unsigned int)FileTell(pitFile);
+		totalBytes += (unsigned long long)FileTell(pitFile);
 		FileRewind(pitFile);
 	}
 
 	bool success;
 	
-	TotalBytesPacket *totalBytesPacket = new TotalBytesPacket(totalBytes);
-	success = bridgeManager->SendPacket(totalBytesPacket);
-	delete totalBytesPacket;
+	TotalBytesPacket totalBytesPacket(totalBytes);
+	success = bridgeManager->SendPacket(&totalBytesPacket);
 
 	if (!success)
 	{
@@ -175,10 +532,9 @@ static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<Par
 		return (false);
 	}
 
-	SessionSetupResponse *totalBytesResponse = new SessionSetupResponse();
-	success = bridgeManager->ReceivePacket(totalBytesResponse);
-	int totalBytesResult = totalBytesResponse->GetResult();
-	delete totalBytesResponse;
+	SessionSetupResponse totalBytesResponse;
+	success = bridgeManager->ReceivePacket(&totalBytesResponse);
+	int totalBytesResult = totalBytesResponse.GetResult();
 
 	if (!success)
 	{
@@ -195,12 +551,46 @@ static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<Par
 	return (true);
 }
 
+static const PitEntry *findPitEntryByFlashFilename(const PitData *pitData, const string& memberName)
+{
+	// Members may be in a directory, and LZ4 compressed members have .lz4 appended to the flash filename.
+	string filename = memberName.substr(memberName.find_last_of('/') + 1);
+
+	if (filename.length() > 4 && Utility::EqualsIgnoringCase(filename.substr(filename.length() - 4), ".lz4"))
+		filename.erase(filename.length() - 4);
+
+	for (unsigned int i = 0; i < pitData->GetEntryCount(); i++)
+	{
+		const PitEntry *pitEntry = pitData->GetEntry(i);
+		const char *flashFilename = pitEntry->GetFlashFilename();
+
+		if (flashFilename[0] != '\0' && Utility::EqualsIgnoringCase(filename, flashFilename))
+			return (pitEntry);
+	}
+
+	return (nullptr);
+}
+
+static bool isPartitionMapped(const vector<PartitionFlashInfo>& partitionFlashInfos, const PitEntry *pitEntry)
+{
+	for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+	{
+		if (it->pitEntry == pitEntry)
+			return (true);
+	}
+
+	return (false);
+}
+
 static bool setupPartitionFlashInfo(const vector<PartitionFile>& partitionFiles, const PitData *pitData, vector<PartitionFlashInfo>& partitionFlashInfos)
 {
 	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
 	{
 		const PitEntry *pitEntry = nullptr;
 
+		if (!it->argumentName)
+			continue;
+
 		// Was the argument a partition identifier?
 		unsigned int partitionIdentifier;
 
@@ -226,137 +616,440 @@ static bool setupPartitionFlashInfo(const vector<PartitionFile>& partitionFiles,
 			}
 		}
 
-		partitionFlashInfos.push_back(PartitionFlashInfo(pitEntry, it->file));
+		partitionFlashInfos.push_back(PartitionFlashInfo(pitEntry, &*it));
 	}
 
-	return (true);
-}
+	// Archive members are flashed to the partitions whose flash filenames they match, unless those partitions were
+	// given a file explicitly. Anything else in an archive (e.g. metadata) is skipped. Members are flashed in the order
+	// they're stored, so they're fed to the archive's verifier in order.
+	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+	{
+		if (it->argumentName)
+			continue;
 
-static bool flashPitData(BridgeManager *bridgeManager, const PitData *pitData)
-{
-	Interface::Print("Uploading PIT\n");
+		const PitEntry *pitEntry = findPitEntryByFlashFilename(pitData, it->memberName);
 
-	if (bridgeManager->SendPitData(pitData))
-	{
-		Interface::Print("PIT upload successful\n\n");
-		return (true);
-	}
-	else
-	{
-		Interface::PrintError("PIT upload failed!\n\n");
-		return (false);
+		if (!pitEntry)
+		{
+			Interface::Print("Skipping %s, no partition is flashed from it.\n", it->memberName.c_str());
+			continue;
+		}
+
+		if (isPartitionMapped(partitionFlashInfos, pitEntry))
+		{
+			Interface::Print("Skipping %s, %s is already being flashed.\n", it->memberName.c_str(), pitEntry->GetPartitionName());
+			continue;
+		}
+
+		partitionFlashInfos.push_back(PartitionFlashInfo(pitEntry, &*it));
 	}
+
+	return (true);
 }
 
-static bool flashFile(BridgeManager *bridgeManager, const PartitionFlashInfo& partitionFlashInfo)
+static void skipUnchangedPartitions(const FlashLedger& ledger, vector<PartitionFlashInfo>& partitionFlashInfos)
 {
-	if (partitionFlashInfo.pitEntry->GetBinaryType() == PitEntry::kBinaryTypeCommunicationProcessor) // Modem
-	{			
-		Interface::Print("Uploading %s\n", partitionFlashInfo.pitEntry->GetPartitionName());
-
-		if (bridgeManager->SendFile(partitionFlashInfo.file, EndModemFileTransferPacket::kDestinationModem,
-			partitionFlashInfo.pitEntry->GetDeviceType()))
+	for (vector<PartitionFlashInfo>::iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end();)
+	{
+		if (ledger.Matches(it->pitEntry->GetIdentifier(), it->partitionFile->prepared->contentHash))
 		{
-			Interface::Print("%s upload successful\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
-			return (true);
+			Interface::Print("Skipping %s, it's unchanged since it was last flashed.\n", it->pitEntry->GetPartitionName());
+			it = partitionFlashInfos.erase(it);
 		}
 		else
 		{
-			Interface::PrintError("%s upload failed!\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
-			return (false);
+			it++;
 		}
 	}
-	else // partitionFlashInfo.pitEntry->GetBinaryType() == PitEntry::kBinaryTypeApplicationProcessor
-	{
-		Interface::Print("Uploading %s\n", partitionFlashInfo.pitEntry->GetPartitionName());
+}
 
-		if (bridgeManager->SendFile(partitionFlashInfo.file, EndPhoneFileTransferPacket::kDestinationPhone,
-			partitionFlashInfo.pitEntry->GetDeviceType(), partitionFlashInfo.pitEntry->GetIdentifier()))
+static void skipCompletedPartitions(const FlashJournal *journal, vector<PartitionFlashInfo>& partitionFlashInfos,
+	vector<PartitionFlashInfo>& completedFlashInfos)
+{
+	for (vector<PartitionFlashInfo>::iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end();)
+	{
+		if (journal->IsCompleted(it->pitEntry->GetIdentifier(), it->partitionFile->prepared->contentHash))
 		{
-			Interface::Print("%s upload successful\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
-			return (true);
+			Interface::Print("Skipping %s, the journal records it as already flashed.\n", it->pitEntry->GetPartitionName());
+
+			completedFlashInfos.push_back(*it);
+			it = partitionFlashInfos.erase(it);
 		}
 		else
 		{
-			Interface::PrintError("%s upload failed!\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
-			return (false);
+			it++;
 		}
 	}
 }
 
-static bool flashPartitions(BridgeManager *bridgeManager, const vector<PartitionFile>& partitionFiles, const PitData *pitData, bool repartition)
+static void detachUnflashedFiles(const vector<PartitionFile>& partitionFiles, const vector<PartitionFlashInfo>& partitionFlashInfos)
 {
-	vector<PartitionFlashInfo> partitionFlashInfos;
+	// Files this device won't flash mustn't hold back the other devices sharing their readers.
+	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+	{
+		if (!it->sharedReader)
+			continue;
 
-	// Map the files being flashed to partitions stored in the PIT file.
-	if (!setupPartitionFlashInfo(partitionFiles, pitData, partitionFlashInfos))
-		return (false);
+		bool flashed = false;
 
-	// If we're repartitioning then we need to flash the PIT file first (if it is listed in the PIT file).
+		for (vector<PartitionFlashInfo>::const_iterator flashInfo = partitionFlashInfos.begin(); flashInfo != partitionFlashInfos.end(); flashInfo++)
+			flashed = flashed || flashInfo->partitionFile == &*it;
+
+		if (!flashed)
+			it->sharedReader->Detach(it->consumer);
+	}
+}
+
+static void forgetPartitions(BridgeManager *bridgeManager, FlashLedger& ledger, const vector<PartitionFlashInfo>& partitionFlashInfos,
+	bool repartition)
+{
+	// Partitions are forgotten before they're flashed, so an interrupted flash can't leave them recorded as holding
+	// what they held previously. Repartitioning may move every partition, so everything is forgotten.
 	if (repartition)
 	{
-		if (!flashPitData(bridgeManager, pitData))
-			return (false);
+		ledger.Clear();
 	}
-
-	// Flash partitions in the same order that arguments were specified in.
-	for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+	else
 	{
-		if (!flashFile(bridgeManager, *it))
-			return (false);
+		for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+			ledger.Remove(it->pitEntry->GetIdentifier());
 	}
-	return (true);
+
+	if (!ledger.Save() && bridgeManager->IsVerbose())
+		Interface::PrintWarning("Failed to update flash ledger.\n");
 }
 
-static PitData *getPitData(BridgeManager *bridgeManager, FILE *pitFile, bool repartition)
+static void recordPartitions(BridgeManager *bridgeManager, FlashLedger& ledger, const vector<PartitionFlashInfo>& partitionFlashInfos)
 {
-	PitData *pitData;
-	PitData *localPitData = nullptr;
-
-	// If a PIT file was passed as an argument then we must unpack it.
+	for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+		ledger.Record(it->pitEntry->GetIdentifier(), it->partitionFile->prepared->contentHash);
 
-	if (pitFile)
-	{
-		// Load the local pit file into memory.
+	if (!ledger.Save() && bridgeManager->IsVerbose())
+		Interface::PrintWarning("Failed to update flash ledger.\n");
+}
 
-		FileSeek(pitFile, 0, SEEK_END);
-		unsigned int localPitFileSize = (unsigned int)FileTell(pitFile);
-		FileRewind(pitFile);
+// Returns 0 if the partition's size isn't known. Other types of device don't necessarily count blocks in sectors, and
+// PITs may leave the block count of a partition that fills the rest of the device as 0.
+static unsigned long long getPartitionCapacity(const PitEntry *pitEntry)
+{
+	if (pitEntry->GetDeviceType() != PitEntry::kDeviceTypeMMC)
+		return (0);
 
-		unsigned char *pitFileBuffer = new unsigned char[localPitFileSize];
-		memset(pitFileBuffer, 0, localPitFileSize);
+	return ((unsigned long long)pitEntry->GetBlockCount() * kMmcSectorSize);
+}
 
-		int dataRead = fread(pitFileBuffer, 1, localPitFileSize, pitFile);
+static const string& getFileDescription(const PartitionFile *partitionFile)
+{
+	return (partitionFile->argumentName ? partitionFile->filename : partitionFile->memberName);
+}
 
-		if (dataRead > 0)
-		{
-			FileRewind(pitFile);
+// Every file is checked, so that all those that are too large are reported at once.
+static bool checkPartitionSizes(const vector<PartitionFlashInfo>& partitionFlashInfos)
+{
+	bool success = true;
 
-			localPitData = new PitData();
-			localPitData->Unpack(pitFileBuffer);
+	for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+	{
+		unsigned long long capacity = getPartitionCapacity(it->pitEntry);
+		unsigned long long dataSize = it->partitionFile->prepared->dataSize;
 
-			delete [] pitFileBuffer;
-		}
-		else
+		if (capacity != 0 && dataSize > capacity)
 		{
-			Interface::PrintError("Failed to read PIT file.\n");
-
-			delete [] pitFileBuffer;
-			return (nullptr);
+			Interface::PrintError("%s is %llu bytes, which is too large for %s (%llu bytes)!\n", getFileDescription(it->partitionFile).c_str(),
+				dataSize, it->pitEntry->GetPartitionName(), capacity);
+			success = false;
 		}
 	}
 
+	return (success);
+}
+
+static void printTransferPlan(const vector<PartitionFlashInfo>& partitionFlashInfos, const PitData *pitData, bool repartition,
+	unsigned int partSize, unsigned int sequenceMaxLength, unsigned int throughput)
+{
+	unsigned long long totalDataSize = 0;
+	unsigned long long totalBytesSent = 0;
+	unsigned int totalPartCount = 0;
+	unsigned int totalSequenceCount = 0;
+	unsigned int totalRoundTrips = 0;
+
+	Interface::Print("Transfer plan (%u byte file parts, up to %u per sequence):\n", partSize, sequenceMaxLength);
+
 	if (repartition)
 	{
-		// Use the local PIT file data.
-		pitData = localPitData;
+		// The PIT is sent whole, in a transfer of its own.
+		unsigned int pitSize = pitData->GetPaddedSize();
+		Interface::Print("  PIT: %u bytes; round trips: 4\n", pitSize);
+
+		totalDataSize += pitSize;
+		totalBytesSent += pitSize;
+		totalRoundTrips += 4;
 	}
-	else
+
+	for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+	{
+		FileTransferPlan transferPlan(it->partitionFile->prepared->dataSize, partSize, sequenceMaxLength);
+
+		// The transfer is begun, then each sequence is begun, sent a part at a time and ended, all awaiting a response.
+		unsigned int roundTrips = 1 + transferPlan.GetSequenceCount() * 2 + transferPlan.GetPartCount();
+		unsigned long long capacity = getPartitionCapacity(it->pitEntry);
+
+		if (capacity != 0)
+			Interface::Print("  %s: %llu of %llu bytes", it->pitEntry->GetPartitionName(), transferPlan.GetFileSize(), capacity);
+		else
+			Interface::Print("  %s: %llu bytes (size not checked)", it->pitEntry->GetPartitionName(), transferPlan.GetFileSize());
+
+		Interface::Print("; parts: %u, sequences: %u, round trips: %u\n", transferPlan.GetPartCount(), transferPlan.GetSequenceCount(),
+			roundTrips);
+
+		// The last part of each file is padded.
+		totalDataSize += transferPlan.GetFileSize();
+		totalBytesSent += (unsigned long long)transferPlan.GetPartCount() * partSize;
+		totalPartCount += transferPlan.GetPartCount();
+		totalSequenceCount += transferPlan.GetSequenceCount();
+		totalRoundTrips += roundTrips;
+	}
+
+	unsigned long long bytesPerSecond = (unsigned long long)throughput * 1048576;
+	unsigned long long seconds = (totalBytesSent + bytesPerSecond - 1) / bytesPerSecond;
+
+	Interface::Print("Total: %llu bytes (%llu sent, including padding); parts: %u, sequences: %u, round trips: %u\n", totalDataSize,
+		totalBytesSent, totalPartCount, totalSequenceCount, totalRoundTrips);
+	Interface::Print("Estimated transfer time at %u MiB/s: %llu:%02llu\n\n", throughput, seconds / 60, seconds % 60);
+}
+
+static bool flashPitData(BridgeManager *bridgeManager, const PitData *pitData)
+{
+	Interface::Print("Uploading PIT\n");
+
+	if (bridgeManager->SendPitData(pitData))
+	{
+		Interface::Print("PIT upload successful\n\n");
+		return (true);
+	}
+	else
+	{
+		Interface::PrintError("PIT upload failed!\n\n");
+		return (false);
+	}
+}
+
+static FilePartSource *createFilePartSource(const PartitionFile *partitionFile)
+{
+	FILE *file = partitionFile->file;
+
+	if (partitionFile->sharedReader)
+		return (new SharedFilePartSource(partitionFile->sharedReader, partitionFile->consumer, file));
+
+	return (FilePartSource::Create(file, partitionFile->offset, partitionFile->length, partitionFile->verifier.get()));
+}
+
+static bool flashFile(BridgeManager *bridgeManager, const PartitionFlashInfo& partitionFlashInfo)
+{
+	FilePartSource *fileSource = createFilePartSource(partitionFlashInfo.partitionFile);
+	bool success;
+
+	Interface::Print("Uploading %s\n", partitionFlashInfo.pitEntry->GetPartitionName());
+
+	if (partitionFlashInfo.pitEntry->GetBinaryType() == PitEntry::kBinaryTypeCommunicationProcessor) // Modem
+	{
+		success = bridgeManager->SendFile(fileSource, EndModemFileTransferPacket::kDestinationModem,
+			partitionFlashInfo.pitEntry->GetDeviceType());
+	}
+	else // partitionFlashInfo.pitEntry->GetBinaryType() == PitEntry::kBinaryTypeApplicationProcessor
+	{
+		success = bridgeManager->SendFile(fileSource, EndPhoneFileTransferPacket::kDestinationPhone,
+			partitionFlashInfo.pitEntry->GetDeviceType(), partitionFlashInfo.pitEntry->GetIdentifier());
+	}
+
+	delete fileSource;
+
+	if (success)
+	{
+		Interface::Print("%s upload successful\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
+		return (true);
+	}
+	else
+	{
+		Interface::PrintError("%s upload failed!\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
+		return (false);
+	}
+}
+
+static bool flashPartitions(BridgeManager *bridgeManager, const vector<PartitionFlashInfo>& partitionFlashInfos, const PitData *pitData,
+	bool repartition, FlashJournal *journal)
+{
+	// If we're repartitioning then we need to flash the PIT file first (if it is listed in the PIT file).
+	if (repartition)
+	{
+		if (!flashPitData(bridgeManager, pitData))
+			return (false);
+	}
+
+	// Flash partitions in the same order that arguments were specified in.
+	for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+	{
+		if (!flashFile(bridgeManager, *it))
+			return (false);
+
+		if (journal && !journal->Record(it->pitEntry->GetIdentifier(), it->partitionFile->prepared->contentHash))
+			Interface::PrintWarning("Failed to record %s in journal \"%s\"\n", it->pitEntry->GetPartitionName(), journal->GetPath().c_str());
+	}
+	return (true);
+}
+
+static void startVerifiers(const vector<PartitionFile>& partitionFiles, const vector<PartitionFlashInfo>& partitionFlashInfos)
+{
+	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+	{
+		if (!it->verifier)
+			continue;
+
+		// The members being flashed are fed to the verifier as they're read, the rest of the archive it reads itself.
+		vector<pair<unsigned long long, unsigned long long>> fedRegions;
+
+		for (vector<PartitionFlashInfo>::const_iterator flashInfo = partitionFlashInfos.begin(); flashInfo != partitionFlashInfos.end(); flashInfo++)
+		{
+			if (flashInfo->partitionFile->verifier == it->verifier)
+				fedRegions.push_back(make_pair(flashInfo->partitionFile->offset, flashInfo->partitionFile->length));
+		}
+
+		it->verifier->Start(fedRegions);
+	}
+}
+
+static bool verifyArchives(const vector<PartitionFile>& partitionFiles)
+{
+	bool success = true;
+	const ArchiveVerifier *previousVerifier = nullptr;
+
+	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+	{
+		// Members of the same archive are adjacent.
+		if (!it->verifier || it->verifier.get() == previousVerifier)
+			continue;
+
+		previousVerifier = it->verifier.get();
+
+		if (it->verifier->Finish())
+			Interface::Print("%s checksum verified\n\n", it->verifier->GetFilename().c_str());
+		else
+			success = false;
+	}
+
+	return (success);
+}
+
+static unsigned int getDevicePitFile(BridgeManager *bridgeManager, unsigned char **pitFileBuffer, bool usePitCache)
+{
+	// PITs are cached by serial number. Devices without one can't be told apart (other units of the same model may be
+	// partitioned differently), so their PIT is always downloaded.
+	if (!usePitCache || bridgeManager->GetSerialNumber().empty())
+		return (bridgeManager->DownloadPitFile(pitFileBuffer));
+
+	PitCache pitCache(bridgeManager->GetSerialNumber());
+
+	unsigned int pitFileSize = pitCache.Load(pitFileBuffer);
+	bool hit = false;
+
+	if (pitFileSize > 0)
+	{
+		Interface::Print("Verifying cached PIT file...\n");
+
+		if (!bridgeManager->VerifyPitFile(*pitFileBuffer, pitFileSize, &hit))
+			Interface::PrintWarning("Failed to verify cached PIT file, downloading it instead.\n");
+
+		if (hit)
+		{
+			Interface::Print("Cached PIT file matches the device.\n\n");
+		}
+		else
+		{
+			delete [] *pitFileBuffer;
+			*pitFileBuffer = nullptr;
+		}
+	}
+
+	if (!hit)
+	{
+		pitFileSize = bridgeManager->DownloadPitFile(pitFileBuffer);
+
+		if (pitFileSize == 0)
+			return (0);
+
+		if (!pitCache.Store(*pitFileBuffer, pitFileSize) && bridgeManager->IsVerbose())
+			Interface::PrintWarning("Failed to cache PIT file.\n");
+	}
+
+	pitCache.RecordResult(hit);
+
+	if (bridgeManager->IsVerbose())
+		Interface::Print("PIT cache hits: %u, misses: %u\n", pitCache.GetHitCount(), pitCache.GetMissCount());
+
+	return (pitFileSize);
+}
+
+static PitData *loadPitFile(FILE *pitFile)
+{
+	// Load the local pit file into memory.
+
+	FileSeek(pitFile, 0, SEEK_END);
+	unsigned int localPitFileSize = (unsigned int)FileTell(pitFile);
+	FileRewind(pitFile);
+
+	unsigned char *pitFileBuffer = new unsigned char[localPitFileSize];
+	memset(pitFileBuffer, 0, localPitFileSize);
+
+	int dataRead = fread(pitFileBuffer, 1, localPitFileSize, pitFile);
+
+	if (dataRead > 0)
+	{
+		FileRewind(pitFile);
+
+		PitData *localPitData = new PitData();
+		localPitData->Unpack(pitFileBuffer);
+
+		delete [] pitFileBuffer;
+		return (localPitData);
+	}
+	else
+	{
+		Interface::PrintError("Failed to read PIT file.\n");
+
+		delete [] pitFileBuffer;
+		return (nullptr);
+	}
+}
+
+static PitData *getPitData(BridgeManager *bridgeManager, FILE *pitFile, bool repartition, bool usePitCache)
+{
+	PitData *pitData;
+	PitData *localPitData = nullptr;
+
+	// If a PIT file was passed as an argument then we must unpack it.
+
+	if (pitFile)
+	{
+		localPitData = loadPitFile(pitFile);
+
+		if (!localPitData)
+			return (nullptr);
+	}
+
+	if (repartition)
+	{
+		// Use the local PIT file data. The cached copy of the device's PIT is about to be out of date.
+		pitData = localPitData;
+
+		if (usePitCache && !bridgeManager->GetSerialNumber().empty())
+			PitCache(bridgeManager->GetSerialNumber()).Remove();
+	}
+	else
 	{
 		// If we're not repartitioning then we need to retrieve the device's PIT file and unpack it.
 		unsigned char *pitFileBuffer;
 
-		if (bridgeManager->DownloadPitFile(&pitFileBuffer) == 0)
+		if (getDevicePitFile(bridgeManager, &pitFileBuffer, usePitCache) == 0)
 			return (nullptr);
 
 		pitData = new PitData();
@@ -386,9 +1079,8 @@ static bool enableTFlash(BridgeManager *bridgeManager)
 {
 	bool success;
 
-	EnableTFlashPacket *enableTFlashPacket = new EnableTFlashPacket();
-	success = bridgeManager->SendPacket(enableTFlashPacket);
-	delete enableTFlashPacket;
+	EnableTFlashPacket enableTFlashPacket;
+	success = bridgeManager->SendPacket(&enableTFlashPacket);
 
 	if (!success)
 	{
@@ -396,10 +1088,9 @@ static bool enableTFlash(BridgeManager *bridgeManager)
 		return false;
 	}
 
-	SessionSetupResponse *enableTFlashResponse = new SessionSetupResponse();
-	success = bridgeManager->ReceivePacket(enableTFlashResponse, 5000);
-	unsigned int result = enableTFlashResponse->GetResult();
-	delete enableTFlashResponse;
+	SessionSetupResponse enableTFlashResponse;
+	success = bridgeManager->ReceivePacket(&enableTFlashResponse, 5000);
+	unsigned int result = enableTFlashResponse.GetResult();
 
 	if (!success)
 	{
@@ -416,8 +1107,369 @@ static bool enableTFlash(BridgeManager *bridgeManager)
 	return true;
 }
 
-int FlashAction::Execute(int argc, char **argv)
+static int flashDevice(const FlashOptions& options, const vector<PartitionFile>& partitionFiles, FILE *pitFile,
+	const string& deviceLocation, FilePreparation *preparation, FlashJournal *journal = nullptr)
+{
+	BridgeManager *bridgeManager = new BridgeManager(options.verbose);
+	bridgeManager->SetUsbLogLevel(options.usbLogLevel);
+	bridgeManager->SetUsbTransferMode(options.usbTransferMode);
+	bridgeManager->SetAutotune(options.autotune);
+	bridgeManager->SetEmptyTransferCalibration(options.calibrateEmptyTransfers);
+	bridgeManager->SetDeviceLocation(deviceLocation);
+
+	if (bridgeManager->Initialise(options.resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
+	{
+		delete bridgeManager;
+		return (1);
+	}
+
+	if (options.tflash && !enableTFlash(bridgeManager))
+	{
+		delete bridgeManager;
+		return (1);
+	}
+
+	if (journal && !journal->Begin(bridgeManager->GetSerialNumber()))
+	{
+		// Nothing has been flashed.
+		bridgeManager->EndSession(options.reboot);
+		delete bridgeManager;
+		return (1);
+	}
+
+	// The ledger is kept by serial number, so without one nothing can be recorded (or skipped). T-Flash flashes an SD
+	// card rather than the device, so doesn't affect it. If the device has no ledger, there's nothing to forget either.
+	FlashLedger ledger(bridgeManager->GetSerialNumber());
+	bool useLedger = !bridgeManager->GetSerialNumber().empty() && !options.tflash && (ledger.Load() || options.skipUnchanged);
+
+	if (options.skipUnchanged && !useLedger)
+		Interface::PrintWarning("Device has no serial number, so unchanged partitions can't be skipped.\n");
+
+	vector<const PartitionFile *> transferFiles;
+	vector<PartitionFlashInfo> partitionFlashInfos;
+	vector<PartitionFlashInfo> completedFlashInfos;
+	PitData *pitData = nullptr;
+	bool success;
+
+	if (!hasArchiveMembers(partitionFiles) && !(options.skipUnchanged && useLedger) && !journal)
+	{
+		for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+			transferFiles.push_back(&*it);
+
+		success = preparation->Finish() && sendTotalTransferSize(bridgeManager, transferFiles, pitFile, options.repartition);
+
+		if (success)
+		{
+			pitData = getPitData(bridgeManager, pitFile, options.repartition, options.usePitCache);
+
+			// Map the files being flashed to partitions stored in the PIT file.
+			success = pitData && setupPartitionFlashInfo(partitionFiles, pitData, partitionFlashInfos)
+				&& checkPartitionSizes(partitionFlashInfos);
+		}
+	}
+	else
+	{
+		// Archive members can only be mapped to partitions once the PIT is known, likewise partitions that are unchanged
+		// or already flashed (according to the journal) can only be identified once it's known. So the PIT is retrieved
+		// first, and files that won't be flashed are left out of the total transfer size.
+		pitData = getPitData(bridgeManager, pitFile, options.repartition, options.usePitCache);
+		success = pitData && setupPartitionFlashInfo(partitionFiles, pitData, partitionFlashInfos) && preparation->Finish();
+
+		if (success)
+		{
+			if (journal)
+				skipCompletedPartitions(journal, partitionFlashInfos, completedFlashInfos);
+
+			if (options.skipUnchanged && useLedger)
+				skipUnchangedPartitions(ledger, partitionFlashInfos);
+
+			for (vector<PartitionFlashInfo>::const_iterator it = partitionFlashInfos.begin(); it != partitionFlashInfos.end(); it++)
+				transferFiles.push_back(it->partitionFile);
+
+			success = checkPartitionSizes(partitionFlashInfos)
+				&& sendTotalTransferSize(bridgeManager, transferFiles, pitFile, options.repartition);
+		}
+	}
+
+	if (success && options.verbose)
+	{
+		printTransferPlan(partitionFlashInfos, pitData, options.repartition, bridgeManager->GetFilePartSize(),
+			bridgeManager->GetFileTransferSequenceMaxLength(), options.throughput);
+	}
+
+	if (success)
+	{
+		detachUnflashedFiles(partitionFiles, partitionFlashInfos);
+
+		if (useLedger)
+			forgetPartitions(bridgeManager, ledger, partitionFlashInfos, options.repartition);
+
+		startVerifiers(partitionFiles, partitionFlashInfos);
+		success = flashPartitions(bridgeManager, partitionFlashInfos, pitData, options.repartition, journal);
+	}
+
+	// Ending the session may reboot the device into whatever was flashed from a corrupt archive, so it's left open.
+	if (success && !verifyArchives(partitionFiles))
+	{
+		Interface::PrintError("Flash aborted! The session hasn't been ended, so the device remains in download mode.\n");
+
+		delete pitData;
+		delete bridgeManager;
+		return (1);
+	}
+
+	// Files are only hashed when skipping unchanged partitions or journalling. Otherwise the partitions flashed remain
+	// forgotten. Partitions flashed before a journalled flash was interrupted are recorded along with the rest.
+	if (success && useLedger && (options.skipUnchanged || journal))
+	{
+		completedFlashInfos.insert(completedFlashInfos.end(), partitionFlashInfos.begin(), partitionFlashInfos.end());
+		recordPartitions(bridgeManager, ledger, completedFlashInfos);
+	}
+
+	delete pitData;
+
+	if (!bridgeManager->EndSession(options.reboot))
+		success = false;
+
+	delete bridgeManager;
+
+	if (success && journal)
+		journal->Remove();
+
+	return (success ? 0 : 1);
+}
+
+// Checks the files against the given PIT and prints the transfer plan, without a device.
+static int planFlash(const FlashOptions& options, const vector<PartitionFile>& partitionFiles, FILE *pitFile, FilePreparation *preparation)
+{
+	PitData *pitData = loadPitFile(pitFile);
+
+	if (!pitData)
+		return (1);
+
+	vector<PartitionFlashInfo> partitionFlashInfos;
+	bool success = setupPartitionFlashInfo(partitionFiles, pitData, partitionFlashInfos) && preparation->Finish()
+		&& checkPartitionSizes(partitionFlashInfos);
+
+	if (success)
+	{
+		// The device may not support changing the file part size, or autotuning may choose another, but most use the default.
+		unsigned int partSize = BridgeManager::kFilePartSizeDefault;
+		printTransferPlan(partitionFlashInfos, pitData, options.repartition, partSize, BridgeManager::kFileTransferSequenceMaxBytes / partSize,
+			options.throughput);
+
+		Interface::Print("Dry run complete, nothing has been flashed.\n");
+	}
+
+	delete pitData;
+	return (success ? 0 : 1);
+}
+
+static int flashDevices(Arguments& arguments, const FlashOptions& options, const vector<string>& deviceLocations,
+	const vector<SharedFilePartReader *>& sharedReaders, const vector<shared_ptr<ArchiveVerifier>>& sharedVerifiers,
+	FilePreparation *preparation)
+{
+	vector<int> results(deviceLocations.size(), 1);
+	vector<thread> threads;
+
+	for (unsigned int i = 0; i < deviceLocations.size(); i++)
+	{
+		threads.push_back(thread([&arguments, &options, &deviceLocations, &sharedReaders, &sharedVerifiers, preparation, &results, i]()
+		{
+			Interface::SetOutputPrefix("[" + deviceLocations[i] + "] ");
+
+			// Each device has its own copy of the files open, but (unless it needs a different part size) receives
+			// their contents from the shared readers.
+			FILE *pitFile = nullptr;
+			vector<PartitionFile> partitionFiles;
+
+			if (openFiles(arguments, partitionFiles, pitFile))
+			{
+				for (unsigned int j = 0; j < partitionFiles.size(); j++)
+				{
+					partitionFiles[j].sharedReader = sharedReaders[j];
+					partitionFiles[j].consumer = i;
+					partitionFiles[j].verifier = sharedVerifiers[j];
+					partitionFiles[j].prepared = &preparation->preparedFiles[j];
+				}
+
+				results[i] = flashDevice(options, partitionFiles, pitFile, deviceLocations[i], preparation);
+			}
+
+			closeFiles(partitionFiles, pitFile);
+
+			// Don't hold back the other devices with files this device didn't get to.
+			for (unsigned int j = 0; j < sharedReaders.size(); j++)
+				sharedReaders[j]->Detach(i);
+		}));
+	}
+
+	for (unsigned int i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	if (options.verbose)
+	{
+		for (unsigned int j = 0; j < sharedReaders.size(); j++)
+		{
+			Interface::Print("File %u: %llu of %llu bytes read from disk for %u devices\n", j + 1, sharedReaders[j]->GetBytesRead(),
+				sharedReaders[j]->GetSize(), (unsigned int)deviceLocations.size());
+		}
+	}
+
+	unsigned int failedCount = 0;
+
+	Interface::Print("\nResults:\n");
+
+	for (unsigned int i = 0; i < deviceLocations.size(); i++)
+	{
+		Interface::Print("    %s: %s (exit code %d)\n", deviceLocations[i].c_str(), (results[i] == 0) ? "succeeded" : "FAILED",
+			results[i]);
+
+		if (results[i] != 0)
+			failedCount++;
+	}
+
+	Interface::Print("%u of %u devices flashed successfully.\n", (unsigned int)deviceLocations.size() - failedCount,
+		(unsigned int)deviceLocations.size());
+
+	return ((failedCount == 0) ? 0 : 1);
+}
+
+static volatile sig_atomic_t stationInterrupted = 0;
+
+static void stationInterruptHandler(int)
+{
+	stationInterrupted = 1;
+
+	// A second interrupt terminates immediately.
+	signal(SIGINT, SIG_DFL);
+}
+
+struct StationJob
+{
+	thread jobThread;
+	bool finished;
+
+	StationJob()
+	{
+		finished = false;
+	}
+};
+
+static int runStation(Arguments& arguments, const FlashOptions& options, unsigned int deviceLimit, FilePreparation *preparation)
 {
+	mutex stationMutex;
+	list<StationJob> jobs;
+	set<string> busyLocations;
+
+	unsigned int startedCount = 0;
+	unsigned int succeededCount = 0;
+	unsigned int failedCount = 0;
+
+	stationInterrupted = 0;
+	signal(SIGINT, stationInterruptHandler);
+
+	Interface::Print("Waiting for devices. Press Ctrl+C to stop.\n\n");
+
+	function<void (const string&)> deviceArrived = [&](const string& location)
+	{
+		unsigned long long arrivalTime = Utility::GetMilliseconds();
+
+		if (stationInterrupted || (deviceLimit > 0 && startedCount >= deviceLimit))
+			return;
+
+		{
+			lock_guard<mutex> lock(stationMutex);
+
+			// The device may be re-enumerated whilst it's being flashed.
+			if (!busyLocations.insert(location).second)
+				return;
+		}
+
+		startedCount++;
+
+		jobs.push_back(StationJob());
+		StationJob *job = &jobs.back();
+
+		job->jobThread = thread([&, location, arrivalTime, job]()
+		{
+			Interface::SetOutputPrefix("[" + location + "] ");
+
+			unsigned long long startTime = Utility::GetMilliseconds();
+			Interface::Print("Device connected, flashing started %llu ms later.\n", startTime - arrivalTime);
+
+			FILE *pitFile = nullptr;
+			vector<PartitionFile> partitionFiles;
+			int result = 1;
+
+			if (openFiles(arguments, partitionFiles, pitFile))
+			{
+				// Files are only prepared once, rather than for every device.
+				for (unsigned int i = 0; i < partitionFiles.size(); i++)
+					partitionFiles[i].prepared = &preparation->preparedFiles[i];
+
+				result = flashDevice(options, partitionFiles, pitFile, location, preparation);
+			}
+
+			closeFiles(partitionFiles, pitFile);
+
+			unsigned long long duration = Utility::GetMilliseconds() - startTime;
+			Interface::Print("Flash %s in %llu.%03llu s.\n", (result == 0) ? "succeeded" : "FAILED", duration / 1000, duration % 1000);
+
+			lock_guard<mutex> lock(stationMutex);
+
+			busyLocations.erase(location);
+
+			if (result == 0)
+				succeededCount++;
+			else
+				failedCount++;
+
+			job->finished = true;
+		});
+	};
+
+	function<bool (void)> keepWatching = [&]()
+	{
+		{
+			lock_guard<mutex> lock(stationMutex);
+
+			for (list<StationJob>::iterator it = jobs.begin(); it != jobs.end();)
+			{
+				if (it->finished)
+				{
+					it->jobThread.join();
+					it = jobs.erase(it);
+				}
+				else
+				{
+					it++;
+				}
+			}
+		}
+
+		return (!stationInterrupted && (deviceLimit == 0 || startedCount < deviceLimit));
+	};
+
+	bool success = BridgeManager::WatchDevices(deviceArrived, keepWatching);
+
+	if (!jobs.empty())
+		Interface::Print("Waiting for %u device(s) to finish...\n", (unsigned int)jobs.size());
+
+	for (list<StationJob>::iterator it = jobs.begin(); it != jobs.end(); it++)
+		it->jobThread.join();
+
+	signal(SIGINT, SIG_DFL);
+
+	Interface::Print("\n%u device(s) flashed successfully, %u failed.\n", succeededCount, failedCount);
+
+	return ((success && failedCount == 0) ? 0 : 1);
+}
+
+static int execute(int argc, char **argv, bool station)
+{
+	const char *actionUsage = (station) ? StationAction::usage : FlashAction::usage;
+
 	// Setup argument types
 
 	map<string, ArgumentType> argumentTypes;
@@ -429,12 +1481,28 @@ int FlashAction::Execute(int argc, char **argv)
 	argumentTypes["resume"] = kArgumentTypeFlag;
 	argumentTypes["verbose"] = kArgumentTypeFlag;
 	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["no-delay"] = kArgumentTypeFlag;
 	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["usb-transfer-mode"] = kArgumentTypeString;
 	argumentTypes["tflash"] = kArgumentTypeFlag;
+	argumentTypes["autotune"] = kArgumentTypeFlag;
+	argumentTypes["calibrate-empty-transfers"] = kArgumentTypeFlag;
+	argumentTypes["no-pit-cache"] = kArgumentTypeFlag;
+	argumentTypes["skip-unchanged"] = kArgumentTypeFlag;
+	argumentTypes["journal"] = kArgumentTypeString;
+	argumentTypes["resume-journal"] = kArgumentTypeString;
+	argumentTypes["all-devices"] = kArgumentTypeFlag;
+	argumentTypes["devices"] = kArgumentTypeString;
+	argumentTypes["count"] = kArgumentTypeString;
+	argumentTypes["dry-run"] = kArgumentTypeFlag;
+	argumentTypes["throughput"] = kArgumentTypeString;
+	argumentTypes["expand-sparse"] = kArgumentTypeFlag;
 
 	argumentTypes["pit"] = kArgumentTypeString;
 	shortArgumentAliases["pit"] = "pit";
 
+	argumentTypes["archive"] = kArgumentTypeString;
+
 	// Add wild-cards "%d" and "%s", for partition identifiers and partition names respectively.
 	argumentTypes["%d"] = kArgumentTypeString;
 	shortArgumentAliases["%d"] = "%d";
@@ -451,7 +1519,7 @@ int FlashAction::Execute(int argc, char **argv)
 
 	if (!arguments.ParseArguments(argc, argv, 2))
 	{
-		Interface::Print(FlashAction::usage);
+		Interface::Print(actionUsage);
 		return (0);
 	}
 
@@ -459,10 +1527,21 @@ int FlashAction::Execute(int argc, char **argv)
 	bool resume = arguments.GetArgument("resume") != nullptr;
 	bool verbose = arguments.GetArgument("verbose") != nullptr;
 	bool tflash = arguments.GetArgument("tflash") != nullptr;
+	bool autotune = arguments.GetArgument("autotune") != nullptr;
+	bool calibrateEmptyTransfers = arguments.GetArgument("calibrate-empty-transfers") != nullptr;
+	bool usePitCache = arguments.GetArgument("no-pit-cache") == nullptr;
+	bool skipUnchanged = arguments.GetArgument("skip-unchanged") != nullptr;
+	bool dryRun = arguments.GetArgument("dry-run") != nullptr;
 	
 	if (arguments.GetArgument("stdout-errors") != nullptr)
 		Interface::SetStdoutErrors(true);
 
+	if (arguments.GetArgument("no-delay") != nullptr)
+		Interface::SetNoDelay(true);
+
+	if (arguments.GetArgument("expand-sparse") != nullptr)
+		FileDecoder::SetExpandSparseImages(true);
+
 	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
 
 	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
@@ -494,7 +1573,31 @@ int FlashAction::Execute(int argc, char **argv)
 		else
 		{
 			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
-			Interface::Print(FlashAction::usage);
+			Interface::Print(actionUsage);
+			return (0);
+		}
+	}
+
+	const StringArgument *usbTransferModeArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-transfer-mode"));
+
+	BridgeManager::UsbTransferMode usbTransferMode = BridgeManager::UsbTransferMode::Default;
+
+	if (usbTransferModeArgument)
+	{
+		const string& usbTransferModeString = usbTransferModeArgument->GetValue();
+
+		if (usbTransferModeString.compare("sync") == 0 || usbTransferModeString.compare("SYNC") == 0)
+		{
+			usbTransferMode = BridgeManager::UsbTransferMode::Sync;
+		}
+		else if (usbTransferModeString.compare("async") == 0 || usbTransferModeString.compare("ASYNC") == 0)
+		{
+			usbTransferMode = BridgeManager::UsbTransferMode::Async;
+		}
+		else
+		{
+			Interface::Print("Unknown USB transfer mode: %s\n\n", usbTransferModeString.c_str());
+			Interface::Print(actionUsage);
 			return (0);
 		}
 	}
@@ -506,10 +1609,116 @@ int FlashAction::Execute(int argc, char **argv)
 	if (repartition && !pitArgument)
 	{
 		Interface::Print("If you wish to repartition then a PIT file must be specified.\n\n");
-		Interface::Print(FlashAction::usage);
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	if (skipUnchanged && (repartition || tflash))
+	{
+		Interface::Print("--skip-unchanged cannot be used with --repartition or --tflash.\n\n");
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	const StringArgument *journalArgument = static_cast<const StringArgument *>(arguments.GetArgument("journal"));
+	const StringArgument *resumeJournalArgument = static_cast<const StringArgument *>(arguments.GetArgument("resume-journal"));
+
+	if (journalArgument && resumeJournalArgument)
+	{
+		Interface::Print("--journal and --resume-journal cannot be used together.\n\n");
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	if ((journalArgument || resumeJournalArgument) && repartition)
+	{
+		Interface::Print("A journal cannot be kept whilst repartitioning.\n\n");
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	const StringArgument *devicesArgument = static_cast<const StringArgument *>(arguments.GetArgument("devices"));
+	bool allDevices = arguments.GetArgument("all-devices") != nullptr;
+
+	if (dryRun && !pitArgument)
+	{
+		Interface::Print("A dry run doesn't connect to a device, so a PIT file must be specified.\n\n");
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	if (dryRun && (station || devicesArgument || allDevices || skipUnchanged || journalArgument || resumeJournalArgument || tflash))
+	{
+		Interface::Print("A dry run doesn't connect to a device, so it can only be used with files, --pit and --repartition.\n\n");
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	const StringArgument *throughputArgument = static_cast<const StringArgument *>(arguments.GetArgument("throughput"));
+	unsigned int throughput = kThroughputEstimateDefault;
+
+	if (throughputArgument && (Utility::ParseUnsignedInt(throughput, throughputArgument->GetValue().c_str()) != kNumberParsingStatusSuccess
+		|| throughput == 0))
+	{
+		Interface::Print("Invalid throughput: %s\n\n", throughputArgument->GetValue().c_str());
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	if (devicesArgument && allDevices)
+	{
+		Interface::Print("--all-devices and --devices cannot be used together.\n\n");
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	const StringArgument *countArgument = static_cast<const StringArgument *>(arguments.GetArgument("count"));
+	unsigned int deviceLimit = 0;
+
+	if ((journalArgument || resumeJournalArgument) && (station || devicesArgument || allDevices))
+	{
+		Interface::Print("A journal can only be kept when flashing a single device.\n\n");
+		Interface::Print(actionUsage);
+		return (0);
+	}
+
+	if (station)
+	{
+		if (devicesArgument || allDevices || resume)
+		{
+			Interface::Print("A station flashes devices as they're connected, so --all-devices, --devices and --resume don't apply.\n\n");
+			Interface::Print(actionUsage);
+			return (0);
+		}
+
+		if (countArgument && (Utility::ParseUnsignedInt(deviceLimit, countArgument->GetValue().c_str()) != kNumberParsingStatusSuccess
+			|| deviceLimit == 0))
+		{
+			Interface::Print("Invalid device count: %s\n\n", countArgument->GetValue().c_str());
+			Interface::Print(actionUsage);
+			return (0);
+		}
+	}
+	else if (countArgument)
+	{
+		Interface::Print(actionUsage);
 		return (0);
 	}
 
+	vector<string> deviceLocations;
+
+	if (devicesArgument)
+	{
+		splitList(devicesArgument->GetValue(), deviceLocations);
+
+		if (deviceLocations.empty())
+		{
+			Interface::Print("No device locations were specified.\n\n");
+			Interface::Print(actionUsage);
+			return (0);
+		}
+	}
+
 	// Open files
 	
 	FILE *pitFile = nullptr;
@@ -523,56 +1732,124 @@ int FlashAction::Execute(int argc, char **argv)
 
 	if (partitionFiles.size() == 0)
 	{
-		Interface::Print(FlashAction::usage);
+		Interface::Print(actionUsage);
 		return (0);
 	}
 
+	FilePreparation preparation(verbose);
+	preparation.Start(partitionFiles, skipUnchanged || journalArgument || resumeJournalArgument);
+
 	// Info
 
 	Interface::PrintReleaseInfo();
-	Sleep(1000);
+	Interface::Pause(1000);
 
-	// Perform flash
+	FlashJournal *journal = nullptr;
+
+	if (journalArgument)
+	{
+		journal = new FlashJournal(journalArgument->GetValue());
+	}
+	else if (resumeJournalArgument)
+	{
+		journal = new FlashJournal(resumeJournalArgument->GetValue());
 
-	BridgeManager *bridgeManager = new BridgeManager(verbose);
-	bridgeManager->SetUsbLogLevel(usbLogLevel);
+		if (!journal->Load())
+		{
+			delete journal;
+			closeFiles(partitionFiles, pitFile);
+			return (1);
+		}
+	}
 
-	if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
+	if (allDevices)
 	{
-		closeFiles(partitionFiles, pitFile);
-		delete bridgeManager;
+		if (!BridgeManager::GetDeviceLocations(deviceLocations))
+		{
+			closeFiles(partitionFiles, pitFile);
+			return (1);
+		}
 
-		return (1);
+		if (deviceLocations.empty())
+		{
+			Interface::PrintDeviceDetectionFailed();
+			closeFiles(partitionFiles, pitFile);
+			return (1);
+		}
+
+		Interface::Print("Flashing %u devices.\n\n", (unsigned int)deviceLocations.size());
 	}
 
-	if (tflash && !enableTFlash(bridgeManager))
+	// Perform flash
+
+	FlashOptions options;
+	options.reboot = reboot;
+	options.resume = resume;
+	options.verbose = verbose;
+	options.tflash = tflash;
+	options.autotune = autotune;
+	options.calibrateEmptyTransfers = calibrateEmptyTransfers;
+	options.usePitCache = usePitCache;
+	options.repartition = repartition;
+	options.skipUnchanged = skipUnchanged;
+	options.throughput = throughput;
+	options.usbLogLevel = usbLogLevel;
+	options.usbTransferMode = usbTransferMode;
+
+	int result;
+
+	if (dryRun)
 	{
+		result = planFlash(options, partitionFiles, pitFile, &preparation);
 		closeFiles(partitionFiles, pitFile);
-		delete bridgeManager;
+	}
+	else if (station)
+	{
+		closeFiles(partitionFiles, pitFile);
+		result = runStation(arguments, options, deviceLimit, &preparation);
+	}
+	else if (deviceLocations.empty())
+	{
+		result = flashDevice(options, partitionFiles, pitFile, "", &preparation, journal);
+		closeFiles(partitionFiles, pitFile);
+	}
+	else
+	{
+		vector<SharedFilePartReader *> sharedReaders;
+		vector<shared_ptr<ArchiveVerifier>> sharedVerifiers;
 
-		return (1);
+		for (unsigned int i = 0; i < partitionFiles.size(); i++)
+		{
+			sharedReaders.push_back(new SharedFilePartReader(partitionFiles[i].file, partitionFiles[i].offset, partitionFiles[i].length,
+				(unsigned int)deviceLocations.size(), partitionFiles[i].verifier.get()));
+			sharedVerifiers.push_back(partitionFiles[i].verifier);
+		}
+
+		result = flashDevices(arguments, options, deviceLocations, sharedReaders, sharedVerifiers, &preparation);
+
+		for (unsigned int i = 0; i < sharedReaders.size(); i++)
+			delete sharedReaders[i];
+
+		closeFiles(partitionFiles, pitFile);
 	}
 
-	bool success = sendTotalTransferSize(bridgeManager, partitionFiles, pitFile, repartition);
+	delete journal;
 
-	if (success)
+	if (verbose)
 	{
-		PitData *pitData = getPitData(bridgeManager, pitFile, repartition);
-	
-		if (pitData)
-			success = flashPartitions(bridgeManager, partitionFiles, pitData, repartition);
-		else
-			success = false;
-
-		delete pitData;
+		Interface::Print("Packet buffers allocated: %u, reused: %u\n", PacketBufferPool::GetAllocationCount(),
+			PacketBufferPool::GetReuseCount());
 	}
 
-	if (!bridgeManager->EndSession(reboot))
-		success = false;
+	return (result);
+}
 
-	delete bridgeManager;
-	
-	closeFiles(partitionFiles, pitFile);
+int FlashAction::Execute(int argc, char **argv)
+{
+	return (execute(argc, argv, false));
+}
 
-	return (success ? 0 : 1);
+int FlashAction::ExecuteStation(int argc, char **argv)
+{
+	return (execute(argc, argv, true));
 }
@@ -28,6 +28,9 @@ namespace Heimdall
 		extern const char *usage;
 
 		int Execute(int argc, char **argv);
+
+		// Flashes each download-mode device as it's connected. See StationAction.
+		int ExecuteStation(int argc, char **argv);
 	}
 }
 
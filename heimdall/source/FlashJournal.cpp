@@ -0,0 +1,141 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <string.h>
+
+// Heimdall
+#include "FlashJournal.h"
+#include "Heimdall.h"
+#include "Interface.h"
+
+using namespace std;
+using namespace Heimdall;
+
+FlashJournal::FlashJournal(const string& path)
+{
+	this->path = path;
+
+	file = nullptr;
+}
+
+FlashJournal::~FlashJournal()
+{
+	if (file)
+		fclose(file);
+}
+
+bool FlashJournal::Load(void)
+{
+	FILE *journalFile = fopen(path.c_str(), "r");
+
+	if (!journalFile)
+	{
+		Interface::PrintError("Failed to open journal \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	char line[256];
+	bool success = fgets(line, sizeof(line), journalFile) && strncmp(line, "serial=", 7) == 0;
+
+	if (success)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		serialNumber = line + 7;
+
+		unsigned int partitionIdentifier;
+		unsigned long long contentHash;
+
+		// A partially written final line (had the flash been interrupted whilst it was written) is ignored.
+		while (fscanf(journalFile, "%u=%llx\n", &partitionIdentifier, &contentHash) == 2)
+			completedHashes[partitionIdentifier] = contentHash;
+	}
+
+	fclose(journalFile);
+
+	if (!success)
+		Interface::PrintError("Journal \"%s\" is corrupt!\n", path.c_str());
+
+	return (success);
+}
+
+bool FlashJournal::Begin(const string& serialNumber)
+{
+	// Without a serial number, there'd be no telling whether a journal being resumed was recorded for this device.
+	if (serialNumber.empty())
+	{
+		Interface::PrintError("Device has no serial number, so a journal can't be kept for it.\n");
+		return (false);
+	}
+
+	if (!completedHashes.empty() && serialNumber != this->serialNumber)
+	{
+		Interface::PrintError("Journal \"%s\" was recorded for device \"%s\", not this one!\n", path.c_str(), this->serialNumber.c_str());
+		return (false);
+	}
+
+	this->serialNumber = serialNumber;
+
+	file = fopen(path.c_str(), "w");
+
+	if (!file)
+	{
+		Interface::PrintError("Failed to open journal \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	fprintf(file, "serial=%s\n", serialNumber.c_str());
+
+	for (map<unsigned int, unsigned long long>::const_iterator it = completedHashes.begin(); it != completedHashes.end(); it++)
+		fprintf(file, "%u=%016llx\n", it->first, it->second);
+
+	if (fflush(file) != 0)
+	{
+		Interface::PrintError("Failed to write journal \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	return (true);
+}
+
+bool FlashJournal::IsCompleted(unsigned int partitionIdentifier, unsigned long long contentHash) const
+{
+	map<unsigned int, unsigned long long>::const_iterator it = completedHashes.find(partitionIdentifier);
+	return (it != completedHashes.end() && it->second == contentHash);
+}
+
+bool FlashJournal::Record(unsigned int partitionIdentifier, unsigned long long contentHash)
+{
+	completedHashes[partitionIdentifier] = contentHash;
+
+	// Flushed straight away, as the journal is only of use if the flash is interrupted.
+	return (file && fprintf(file, "%u=%016llx\n", partitionIdentifier, contentHash) > 0 && fflush(file) == 0);
+}
+
+void FlashJournal::Remove(void)
+{
+	if (file)
+	{
+		fclose(file);
+		file = nullptr;
+	}
+
+	remove(path.c_str());
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef FLASHJOURNAL_H
+#define FLASHJOURNAL_H
+
+// C/C++ Standard Library
+#include <map>
+#include <stdio.h>
+#include <string>
+
+namespace Heimdall
+{
+	// Records each partition (by PIT identifier) as it's successfully flashed, along with the hash of the file flashed
+	// to it, so that an interrupted flash can be resumed from the first partition that didn't finish.
+	class FlashJournal
+	{
+		private:
+
+			std::string path;
+			FILE *file;
+
+			// The serial number of the device the journal was recorded for, as a journal mustn't be resumed on another.
+			std::string serialNumber;
+			std::map<unsigned int, unsigned long long> completedHashes;
+
+		public:
+
+			FlashJournal(const std::string& path);
+			~FlashJournal();
+
+			// Reads a journal recorded by an earlier flash, to resume it.
+			bool Load(void);
+
+			// (Re)writes the journal, with any partitions loaded from it, ready to record partitions as they're flashed. Fails
+			// if the device has no serial number, or the journal was recorded for another device.
+			bool Begin(const std::string& serialNumber);
+
+			bool IsCompleted(unsigned int partitionIdentifier, unsigned long long contentHash) const;
+			bool Record(unsigned int partitionIdentifier, unsigned long long contentHash);
+
+			// Once the flash has finished there's nothing left to resume.
+			void Remove(void);
+
+			const std::string& GetPath(void) const
+			{
+				return (path);
+			}
+	};
+}
+
+#endif
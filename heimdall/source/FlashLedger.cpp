@@ -0,0 +1,78 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "FlashLedger.h"
+#include "Heimdall.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+FlashLedger::FlashLedger(const string& serialNumber)
+{
+	if (!Utility::GetCacheFilePath(path, "ledger", serialNumber, ".txt"))
+		path.clear();
+}
+
+bool FlashLedger::Load(void)
+{
+	contentHashes.clear();
+
+	if (path.empty())
+		return (false);
+
+	FILE *file = fopen(path.c_str(), "r");
+
+	if (!file)
+		return (false);
+
+	unsigned int partitionIdentifier;
+	unsigned long long contentHash;
+
+	while (fscanf(file, "%u=%llx\n", &partitionIdentifier, &contentHash) == 2)
+		contentHashes[partitionIdentifier] = contentHash;
+
+	fclose(file);
+	return (true);
+}
+
+bool FlashLedger::Save(void) const
+{
+	if (path.empty())
+		return (false);
+
+	return (Utility::WriteFileAtomically(path, "w", [this](FILE *file)
+	{
+		for (map<unsigned int, unsigned long long>::const_iterator it = contentHashes.begin(); it != contentHashes.end(); it++)
+			fprintf(file, "%u=%016llx\n", it->first, it->second);
+
+		return (true);
+	}));
+}
+
+bool FlashLedger::Matches(unsigned int partitionIdentifier, unsigned long long contentHash) const
+{
+	map<unsigned int, unsigned long long>::const_iterator it = contentHashes.find(partitionIdentifier);
+	return (it != contentHashes.end() && it->second == contentHash);
+}
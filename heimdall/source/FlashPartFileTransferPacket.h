@@ -28,6 +28,12 @@ namespace Heimdall
 {
 	class FlashPartFileTransferPacket : public FileTransferPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<FileTransferPacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		private:
 
 			unsigned int sequenceByteCount;
@@ -49,7 +55,7 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, sequenceByteCount);
+				Layout::Pack(data, sequenceByteCount);
 			}
 	};
 }
@@ -54,7 +54,7 @@
 
 #endif
 
-#if (!(defined _MSC_VER) || (_MSC_VER < 1700))
+#if ((defined _MSC_VER) && (_MSC_VER < 1700)) || (!(defined _MSC_VER) && (__cplusplus < 201103L))
 
 #ifndef nullptr
 #define nullptr 0
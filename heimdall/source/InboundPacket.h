@@ -21,6 +21,9 @@
 #ifndef INBOUNDPACKET_H
 #define INBOUNDPACKET_H
 
+// libpit
+#include "PackedLayout.h"
+
 // Heimdall
 #include "Packet.h"
 
@@ -33,24 +36,14 @@ namespace Heimdall
 			bool sizeVariable;
 			unsigned int receivedSize;
 
-		protected:
+		public:
 
-			unsigned int UnpackInteger(unsigned int offset) const
+			InboundPacket(unsigned int size, bool sizeVariable = false) : Packet(size)
 			{
-#ifdef WORDS_BIGENDIAN
-				unsigned int value = (data[offset] << 24) | (data[offset + 1] << 16) |
-					(data[offset + 2] << 8) | data[offset + 3];
-#else
-				// Flip endianness
-				unsigned int value = data[offset] | (data[offset + 1] << 8) |
-					(data[offset + 2] << 16) | (data[offset + 3] << 24);
-#endif
-				return (value);
+				this->sizeVariable = sizeVariable;
 			}
 
-		public:
-
-			InboundPacket(unsigned int size, bool sizeVariable = false) : Packet(size)
+			InboundPacket(unsigned char *buffer, unsigned int size, bool sizeVariable = false) : Packet(buffer, size)
 			{
 				this->sizeVariable = sizeVariable;
 			}
@@ -69,8 +62,6 @@ namespace Heimdall
 			{
 				this->receivedSize = receivedSize;
 			}
-
-			virtual bool Unpack(void) = 0;
 	};
 }
 
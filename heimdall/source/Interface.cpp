@@ -21,18 +21,28 @@
 // C/C++ Standard Library
 #include <cstdarg>
 #include <cstdlib>
+#include <mutex>
 #include <stdio.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#endif
 
 // Heimdall
+#include "BatchAction.h"
 #include "ClosePcScreenAction.h"
+#include "DaemonAction.h"
 #include "DetectAction.h"
 #include "DownloadPitAction.h"
+#include "DumpAction.h"
 #include "FlashAction.h"
 #include "HelpAction.h"
 #include "InfoAction.h"
 #include "Heimdall.h"
 #include "Interface.h"
 #include "PrintPitAction.h"
+#include "StationAction.h"
 #include "VersionAction.h"
 
 using namespace std;
@@ -41,6 +51,13 @@ using namespace Heimdall;
 
 map<string, Interface::ActionInfo> actionMap;
 bool stdoutErrors = false;
+bool noDelay = false;
+
+static mutex outputMutex;
+static thread_local string outputPrefix;
+static thread_local string pendingStandardOutput;
+static thread_local string pendingErrorOutput;
+static thread_local FILE *outputFile = nullptr;
 		
 const char *version = "v1.4.2";
 const char *actionUsage = "Usage: heimdall <action> <action arguments>\n";
@@ -60,13 +77,17 @@ libusbx is licensed under the LGPL-2.1:\n\
 
 void populateActionMap(void)
 {
+	actionMap["batch"] = Interface::ActionInfo(&BatchAction::Execute, BatchAction::usage);
 	actionMap["close-pc-screen"] = Interface::ActionInfo(&ClosePcScreenAction::Execute, ClosePcScreenAction::usage);
+	actionMap["daemon"] = Interface::ActionInfo(&DaemonAction::Execute, DaemonAction::usage);
 	actionMap["detect"] = Interface::ActionInfo(&DetectAction::Execute, DetectAction::usage);
 	actionMap["download-pit"] = Interface::ActionInfo(&DownloadPitAction::Execute, DownloadPitAction::usage);
+	actionMap["dump"] = Interface::ActionInfo(&DumpAction::Execute, DumpAction::usage);
 	actionMap["flash"] = Interface::ActionInfo(&FlashAction::Execute, FlashAction::usage);
 	actionMap["help"] = Interface::ActionInfo(&HelpAction::Execute, HelpAction::usage);
 	actionMap["info"] = Interface::ActionInfo(&InfoAction::Execute, InfoAction::usage);
 	actionMap["print-pit"] = Interface::ActionInfo(&PrintPitAction::Execute, PrintPitAction::usage);
+	actionMap["station"] = Interface::ActionInfo(&StationAction::Execute, StationAction::usage);
 	actionMap["version"] = Interface::ActionInfo(&VersionAction::Execute, VersionAction::usage);
 }
 
@@ -78,16 +99,65 @@ const map<string, Interface::ActionInfo>& Interface::GetActionMap(void)
 	return actionMap;
 }
 
+static void writeOutput(FILE *stream, const char *tag, const char *format, va_list args)
+{
+	string& pendingOutput = (stream == stderr) ? pendingErrorOutput : pendingStandardOutput;
+
+	if (outputFile)
+		stream = outputFile;
+
+	if (outputPrefix.empty())
+	{
+		lock_guard<mutex> lock(outputMutex);
+
+		if (tag)
+			fputs(tag, stream);
+
+		vfprintf(stream, format, args);
+		fflush(stream);
+
+		return;
+	}
+
+	va_list sizeArgs;
+	va_copy(sizeArgs, args);
+	int length = vsnprintf(nullptr, 0, format, sizeArgs);
+	va_end(sizeArgs);
+
+	if (length < 0)
+		return;
+
+	vector<char> text(length + 1);
+	vsnprintf(text.data(), text.size(), format, args);
+
+	if (tag)
+		pendingOutput += tag;
+
+	pendingOutput += text.data();
+
+	lock_guard<mutex> lock(outputMutex);
+	size_t lineEnd;
+
+	while ((lineEnd = pendingOutput.find('\n')) != string::npos)
+	{
+		// Blank lines only separate output from a single device, and are just noise when interleaved.
+		if (lineEnd > 0)
+			fprintf(stream, "%s%.*s\n", outputPrefix.c_str(), (int)lineEnd, pendingOutput.c_str());
+
+		pendingOutput.erase(0, lineEnd + 1);
+	}
+
+	fflush(stream);
+}
+
 void Interface::Print(const char *format, ...)
 {
 	va_list args;
 	va_start(args, format);
 
-	vfprintf(stdout, format, args);
-	fflush(stdout);
+	writeOutput(stdout, nullptr, format, args);
 
 	va_end(args);
-	
 }
 
 void Interface::PrintWarning(const char *format, ...)
@@ -95,19 +165,15 @@ void Interface::PrintWarning(const char *format, ...)
 	va_list stderrArgs;
 	va_start(stderrArgs, format);
 
-	if (stdoutErrors)
+	if (stdoutErrors && !outputFile)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		fprintf(stdout, "WARNING: ");
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		writeOutput(stdout, "WARNING: ", format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	fprintf(stderr, "WARNING: ");
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	writeOutput(stderr, "WARNING: ", format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -117,17 +183,15 @@ void Interface::PrintWarningSameLine(const char *format, ...)
 	va_list stderrArgs;
 	va_start(stderrArgs, format);
 
-	if (stdoutErrors)
+	if (stdoutErrors && !outputFile)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		writeOutput(stdout, nullptr, format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	writeOutput(stderr, nullptr, format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -137,19 +201,15 @@ void Interface::PrintError(const char *format, ...)
 	va_list stderrArgs;
 	va_start(stderrArgs, format);
 
-	if (stdoutErrors)
+	if (stdoutErrors && !outputFile)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		fprintf(stdout, "ERROR: ");
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		writeOutput(stdout, "ERROR: ", format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	fprintf(stderr, "ERROR: ");
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	writeOutput(stderr, "ERROR: ", format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -159,17 +219,15 @@ void Interface::PrintErrorSameLine(const char *format, ...)
 	va_list stderrArgs;
 	va_start(stderrArgs, format);
 
-	if (stdoutErrors)
+	if (stdoutErrors && !outputFile)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		writeOutput(stdout, nullptr, format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	writeOutput(stderr, nullptr, format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -330,3 +388,38 @@ void Interface::SetStdoutErrors(bool enabled)
 {
 	stdoutErrors = enabled;
 }
+
+void Interface::Pause(unsigned int milliseconds)
+{
+	if (noDelay || outputFile)
+		return;
+
+#ifdef _WIN32
+	bool interactive = _isatty(_fileno(stdout)) != 0;
+#else
+	bool interactive = isatty(fileno(stdout)) != 0;
+#endif
+
+	if (interactive)
+		Sleep(milliseconds);
+}
+
+void Interface::SetNoDelay(bool enabled)
+{
+	noDelay = enabled;
+}
+
+void Interface::SetOutputPrefix(const string& prefix)
+{
+	outputPrefix = prefix;
+}
+
+bool Interface::HasOutputPrefix(void)
+{
+	return (!outputPrefix.empty());
+}
+
+void Interface::SetOutputFile(FILE *file)
+{
+	outputFile = file;
+}
@@ -23,6 +23,7 @@
 
 // C/C++ Standard Library
 #include <map>
+#include <stdio.h>
 #include <string>
 
 // libpit
@@ -74,6 +75,20 @@ namespace Heimdall
 		void PrintPit(const libpit::PitData *pitData);
 
 		void SetStdoutErrors(bool enabled);
+
+		// Pauses to give the user time to read what's been printed. There's no one to read it when output isn't to a
+		// terminal (e.g. Heimdall is being run by a script), in which case, or if delays are disabled, this does nothing.
+		void Pause(unsigned int milliseconds);
+		void SetNoDelay(bool enabled);
+
+		// Output is safe to produce from several threads at once. When a thread has an output prefix (e.g. identifying
+		// the device it's handling) its output is gathered into lines, each written with the prefix.
+		void SetOutputPrefix(const std::string& prefix);
+		bool HasOutputPrefix(void);
+
+		// Sends all of the calling thread's output, errors included, to the given file (e.g. a client connection)
+		// rather than stdout and stderr. Passing nullptr restores the default.
+		void SetOutputFile(FILE *file);
 	}
 }
 
@@ -0,0 +1,410 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+// libpit
+#include "PackedLayout.h"
+
+// Heimdall
+#include "ArchiveVerifier.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "Lz4FrameDecoder.h"
+
+using namespace std;
+using namespace Heimdall;
+
+enum
+{
+	kFrameFlagVersionMask = 0xC0,
+	kFrameFlagVersion = 0x40,
+	kFrameFlagBlockIndependence = 0x20,
+	kFrameFlagBlockChecksum = 0x10,
+	kFrameFlagContentSize = 0x08,
+	kFrameFlagContentChecksum = 0x04,
+	kFrameFlagDictionaryId = 0x01
+};
+
+static const unsigned int kBlockSizeUncompressed = 0x80000000;
+
+static bool readLengthExtension(const unsigned char *source, unsigned int sourceSize, unsigned int& sourceOffset, unsigned int& length)
+{
+	unsigned int extension;
+
+	do
+	{
+		if (sourceOffset >= sourceSize)
+			return (false);
+
+		extension = source[sourceOffset++];
+		length += extension;
+	} while (extension == 255);
+
+	return (true);
+}
+
+// Decodes an LZ4 block into window, starting at outputOffset. Matches may refer back to anything already in window.
+static bool decompressBlock(const unsigned char *source, unsigned int sourceSize, unsigned char *window, unsigned int outputOffset,
+	unsigned int outputLimit, unsigned int *outputEnd)
+{
+	unsigned int sourceOffset = 0;
+
+	while (sourceOffset < sourceSize)
+	{
+		unsigned int token = source[sourceOffset++];
+
+		unsigned int literalLength = token >> 4;
+
+		if (literalLength == 15 && !readLengthExtension(source, sourceSize, sourceOffset, literalLength))
+			return (false);
+
+		if (literalLength > sourceSize - sourceOffset || literalLength > outputLimit - outputOffset)
+			return (false);
+
+		memcpy(window + outputOffset, source + sourceOffset, literalLength);
+		sourceOffset += literalLength;
+		outputOffset += literalLength;
+
+		// The last sequence consists of literals alone.
+		if (sourceOffset == sourceSize)
+			break;
+
+		if (sourceSize - sourceOffset < 2)
+			return (false);
+
+		unsigned int matchOffset = source[sourceOffset] | (source[sourceOffset + 1] << 8);
+		sourceOffset += 2;
+
+		if (matchOffset == 0 || matchOffset > outputOffset)
+			return (false);
+
+		unsigned int matchLength = token & 15;
+
+		if (matchLength == 15 && !readLengthExtension(source, sourceSize, sourceOffset, matchLength))
+			return (false);
+
+		matchLength += 4;
+
+		if (matchLength > outputLimit - outputOffset)
+			return (false);
+
+		unsigned char *output = window + outputOffset;
+
+		if (matchOffset >= matchLength)
+		{
+			memcpy(output, output - matchOffset, matchLength);
+		}
+		else
+		{
+			// The match overlaps the output, repeating its first matchOffset bytes. Each copy doubles the length of the
+			// repeated run, so long runs (e.g. of zeros) don't need copying byte by byte.
+			memcpy(output, output - matchOffset, matchOffset);
+
+			unsigned int copied = matchOffset;
+
+			while (copied < matchLength)
+			{
+				unsigned int count = (matchLength - copied < copied) ? matchLength - copied : copied;
+				memcpy(output + copied, output, count);
+				copied += count;
+			}
+		}
+
+		outputOffset += matchLength;
+	}
+
+	*outputEnd = outputOffset;
+	return (true);
+}
+
+Lz4FrameDecoder::Lz4FrameDecoder(FILE *file, unsigned long long offset, ArchiveVerifier *verifier)
+{
+	this->file = file;
+	this->offset = offset;
+	this->verifier = verifier;
+
+	position = offset;
+
+	independentBlocks = false;
+	blockChecksums = false;
+	contentChecksum = false;
+	blockMaxSize = 0;
+
+	contentSize = 0;
+	bytesDecoded = 0;
+	frameEnded = false;
+
+	windowReadOffset = 0;
+	windowEnd = 0;
+}
+
+bool Lz4FrameDecoder::IsLz4File(FILE *file, unsigned long long offset)
+{
+	FileSeek(file, offset, SEEK_SET);
+
+	unsigned char magicNumber[4];
+	bool isLz4File = fread(magicNumber, 1, 4, file) == 4
+		&& libpit::PackedField<unsigned int>::Load(magicNumber) == kMagicNumber;
+
+	FileRewind(file);
+
+	return (isLz4File);
+}
+
+bool Lz4FrameDecoder::ReadData(unsigned char *data, unsigned int length)
+{
+	if (fread(data, 1, length, file) != length)
+		return (false);
+
+	if (verifier)
+		verifier->Feed(position, data, length);
+
+	position += length;
+	return (true);
+}
+
+bool Lz4FrameDecoder::ReadLittleEndian32(unsigned int *value)
+{
+	unsigned char data[4];
+
+	if (!ReadData(data, 4))
+		return (false);
+
+	*value = libpit::PackedField<unsigned int>::Load(data);
+	return (true);
+}
+
+bool Lz4FrameDecoder::ReadHeader(void)
+{
+	FileSeek(file, offset, SEEK_SET);
+	position = offset;
+
+	unsigned char header[19];
+
+	// Magic number, flags and block descriptor.
+	if (!ReadData(header, 6) || libpit::PackedField<unsigned int>::Load(header) != kMagicNumber)
+	{
+		Interface::PrintError("Failed to read LZ4 frame header!\n");
+		return (false);
+	}
+
+	unsigned char flags = header[4];
+	unsigned char blockDescriptor = header[5];
+
+	if ((flags & kFrameFlagVersionMask) != kFrameFlagVersion)
+	{
+		Interface::PrintError("Unsupported LZ4 frame version!\n");
+		return (false);
+	}
+
+	if (flags & kFrameFlagDictionaryId)
+	{
+		Interface::PrintError("LZ4 frames compressed with a dictionary are not supported!\n");
+		return (false);
+	}
+
+	if (!(flags & kFrameFlagContentSize))
+	{
+		Interface::PrintError("LZ4 file doesn't record its uncompressed size, it must be compressed with lz4 --content-size!\n");
+		return (false);
+	}
+
+	unsigned int blockMaxSizeId = (blockDescriptor >> 4) & 0x7;
+
+	if (blockMaxSizeId < 4)
+	{
+		Interface::PrintError("Invalid LZ4 block maximum size!\n");
+		return (false);
+	}
+
+	// Content size and header checksum.
+	if (!ReadData(header + 6, 9))
+	{
+		Interface::PrintError("Failed to read LZ4 frame header!\n");
+		return (false);
+	}
+
+	unsigned char headerChecksum = (Xxh32::Hash(header + 4, 10) >> 8) & 0xFF;
+
+	if (header[14] != headerChecksum)
+	{
+		Interface::PrintError("LZ4 frame header is corrupt!\n");
+		return (false);
+	}
+
+	independentBlocks = (flags & kFrameFlagBlockIndependence) != 0;
+	blockChecksums = (flags & kFrameFlagBlockChecksum) != 0;
+	contentChecksum = (flags & kFrameFlagContentChecksum) != 0;
+	blockMaxSize = 1 << (8 + 2 * blockMaxSizeId);
+
+	contentSize = 0;
+
+	for (int i = 7; i >= 0; i--)
+		contentSize = (contentSize << 8) | header[6 + i];
+
+	bytesDecoded = 0;
+	frameEnded = false;
+	contentHash = Xxh32();
+
+	compressedBlock.resize(blockMaxSize);
+	window.resize((independentBlocks ? 0 : kMaxMatchOffset) + blockMaxSize);
+	windowReadOffset = 0;
+	windowEnd = 0;
+
+	return (true);
+}
+
+bool Lz4FrameDecoder::DecodeBlock(void)
+{
+	unsigned int blockSize;
+
+	if (frameEnded || !ReadLittleEndian32(&blockSize))
+	{
+		Interface::PrintError("Failed to read LZ4 block!\n");
+		return (false);
+	}
+
+	bool uncompressed = (blockSize & kBlockSizeUncompressed) != 0;
+	blockSize &= ~kBlockSizeUncompressed;
+
+	if (blockSize == 0)
+	{
+		Interface::PrintError("LZ4 frame ended before its recorded size!\n");
+		return (false);
+	}
+
+	if (blockSize > blockMaxSize)
+	{
+		Interface::PrintError("LZ4 block is corrupt!\n");
+		return (false);
+	}
+
+	// Keep the end of the previous block, for this block's matches to refer back to.
+	unsigned int historyLength = 0;
+
+	if (!independentBlocks)
+	{
+		historyLength = (windowEnd < kMaxMatchOffset) ? windowEnd : (unsigned int)kMaxMatchOffset;
+		memmove(window.data(), window.data() + windowEnd - historyLength, historyLength);
+	}
+
+	unsigned char *blockData = uncompressed ? window.data() + historyLength : compressedBlock.data();
+
+	if (!ReadData(blockData, blockSize))
+	{
+		Interface::PrintError("Failed to read LZ4 block!\n");
+		return (false);
+	}
+
+	if (blockChecksums)
+	{
+		unsigned int blockChecksum;
+
+		if (!ReadLittleEndian32(&blockChecksum) || blockChecksum != Xxh32::Hash(blockData, blockSize))
+		{
+			Interface::PrintError("LZ4 block checksum mismatch!\n");
+			return (false);
+		}
+	}
+
+	windowReadOffset = historyLength;
+
+	if (uncompressed)
+	{
+		windowEnd = historyLength + blockSize;
+	}
+	else if (!decompressBlock(blockData, blockSize, window.data(), historyLength, historyLength + blockMaxSize, &windowEnd))
+	{
+		Interface::PrintError("LZ4 block is corrupt!\n");
+		return (false);
+	}
+
+	if (contentChecksum)
+		contentHash.Update(window.data() + windowReadOffset, windowEnd - windowReadOffset);
+
+	return (true);
+}
+
+bool Lz4FrameDecoder::EndFrame(void)
+{
+	unsigned int endMark;
+
+	if (!ReadLittleEndian32(&endMark) || endMark != 0)
+	{
+		Interface::PrintError("LZ4 frame is longer than its recorded size!\n");
+		return (false);
+	}
+
+	if (contentChecksum)
+	{
+		unsigned int checksum;
+
+		if (!ReadLittleEndian32(&checksum) || checksum != contentHash.GetDigest())
+		{
+			Interface::PrintError("LZ4 content checksum mismatch!\n");
+			return (false);
+		}
+	}
+
+	frameEnded = true;
+	return (true);
+}
+
+bool Lz4FrameDecoder::Read(unsigned char *buffer, unsigned int length)
+{
+	if (length > contentSize - bytesDecoded)
+		return (false);
+
+	while (length > 0)
+	{
+		if (windowReadOffset == windowEnd && !DecodeBlock())
+			return (false);
+
+		unsigned int count = windowEnd - windowReadOffset;
+
+		if (count > length)
+			count = length;
+
+		memcpy(buffer, window.data() + windowReadOffset, count);
+
+		windowReadOffset += count;
+		buffer += count;
+		length -= count;
+		bytesDecoded += count;
+	}
+
+	// Everything has been delivered, so there shouldn't be any data left. Check the end of the frame now, rather than
+	// waiting for a read that'll never come.
+	if (bytesDecoded == contentSize)
+	{
+		if (windowReadOffset != windowEnd)
+		{
+			Interface::PrintError("LZ4 frame is longer than its recorded size!\n");
+			return (false);
+		}
+
+		if (!frameEnded && !EndFrame())
+			return (false);
+	}
+
+	return (true);
+}
@@ -0,0 +1,106 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef LZ4FRAMEDECODER_H
+#define LZ4FRAMEDECODER_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <vector>
+
+// Heimdall
+#include "FileDecoder.h"
+#include "XxHash.h"
+
+namespace Heimdall
+{
+	// Decompresses an LZ4 frame (e.g. Samsung's *.img.lz4 firmware files) as it's read from a file, so only a couple of
+	// blocks are held in memory at once.
+	class Lz4FrameDecoder : public FileDecoder
+	{
+		public:
+
+			enum
+			{
+				kMagicNumber = 0x184D2204
+			};
+
+		private:
+
+			enum
+			{
+				kMaxMatchOffset = 65536
+			};
+
+			FILE *file;
+			unsigned long long offset;
+
+			// Compressed data is fed to the verifier (if any) as it's read.
+			ArchiveVerifier *verifier;
+			unsigned long long position;
+
+			bool independentBlocks;
+			bool blockChecksums;
+			bool contentChecksum;
+			unsigned int blockMaxSize;
+
+			unsigned long long contentSize;
+			unsigned long long bytesDecoded;
+			bool frameEnded;
+
+			Xxh32 contentHash;
+
+			std::vector<unsigned char> compressedBlock;
+
+			// Holds the most recently decoded block, preceded by the data before it that the block may refer back to.
+			std::vector<unsigned char> window;
+			unsigned int windowReadOffset;
+			unsigned int windowEnd;
+
+			bool ReadData(unsigned char *data, unsigned int length);
+			bool ReadLittleEndian32(unsigned int *value);
+
+			bool DecodeBlock(void);
+			bool EndFrame(void);
+
+		public:
+
+			// The frame begins at offset within the file.
+			Lz4FrameDecoder(FILE *file, unsigned long long offset = 0, ArchiveVerifier *verifier = nullptr);
+
+			// Checks for the LZ4 frame magic number at offset, leaving the file rewound.
+			static bool IsLz4File(FILE *file, unsigned long long offset = 0);
+
+			// Reads the frame header. Only frames that record their uncompressed size (i.e.
+			// compressed with lz4 --content-size, as Samsung's are) are supported, so that the amount of data to be
+			// flashed is known upfront. Reading the header again starts the frame over.
+			bool ReadHeader(void);
+
+			unsigned long long GetContentSize(void) const
+			{
+				return (contentSize);
+			}
+
+			// Decompresses exactly length bytes into the buffer.
+			bool Read(unsigned char *buffer, unsigned int length);
+	};
+}
+
+#endif
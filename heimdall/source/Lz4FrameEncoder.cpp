@@ -0,0 +1,264 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+// libpit
+#include "PackedLayout.h"
+
+// Heimdall
+#include "Interface.h"
+#include "Lz4FrameDecoder.h"
+#include "Lz4FrameEncoder.h"
+
+using namespace std;
+using namespace Heimdall;
+
+enum
+{
+	// Version 1, independent blocks, content size and content checksum.
+	kFrameFlags = 0x40 | 0x20 | 0x08 | 0x04,
+
+	// 4 MiB maximum block size.
+	kBlockDescriptor = 7 << 4,
+
+	kMinMatchLength = 4,
+	kMaxMatchOffset = 65535,
+
+	// The last 5 bytes of a block are always literals, and the last match must begin at least 12 bytes from the end.
+	kLastLiteralsLength = 5,
+	kMatchFindLimit = 12,
+
+	// Incompressible data is skipped through progressively faster, after this many attempts to find a match.
+	kSkipTrigger = 6
+};
+
+static const unsigned int kBlockSizeUncompressed = 0x80000000;
+
+// End mark and content checksum.
+typedef libpit::PackedLayout<0, unsigned int, unsigned int> FrameEndLayout;
+
+static unsigned int writeLengthExtension(unsigned char *destination, unsigned int length)
+{
+	unsigned int count = 0;
+
+	while (length >= 255)
+	{
+		destination[count++] = 255;
+		length -= 255;
+	}
+
+	destination[count++] = length;
+	return (count);
+}
+
+// Appends a sequence of literals, optionally followed by a match, to destination. Returns false if it doesn't fit.
+static bool writeSequence(const unsigned char *literals, unsigned int literalLength, unsigned int matchOffset,
+	unsigned int matchLength, unsigned char *destination, unsigned int destinationCapacity, unsigned int& destinationOffset)
+{
+	unsigned int worstCaseLength = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+
+	if (destinationCapacity - destinationOffset < worstCaseLength)
+		return (false);
+
+	unsigned char *token = destination + destinationOffset++;
+	*token = ((literalLength < 15) ? literalLength : 15) << 4;
+
+	if (literalLength >= 15)
+		destinationOffset += writeLengthExtension(destination + destinationOffset, literalLength - 15);
+
+	memcpy(destination + destinationOffset, literals, literalLength);
+	destinationOffset += literalLength;
+
+	if (matchLength > 0)
+	{
+		destination[destinationOffset++] = matchOffset & 0xFF;
+		destination[destinationOffset++] = (matchOffset >> 8) & 0xFF;
+
+		unsigned int matchLengthCode = matchLength - kMinMatchLength;
+		*token |= (matchLengthCode < 15) ? matchLengthCode : 15;
+
+		if (matchLengthCode >= 15)
+			destinationOffset += writeLengthExtension(destination + destinationOffset, matchLengthCode - 15);
+	}
+
+	return (true);
+}
+
+// Compresses a block with a single pass over it, matching each position against the last position with the same
+// first 4 bytes. Returns 0 if the block doesn't compress into destinationCapacity bytes.
+static unsigned int compressBlock(const unsigned char *source, unsigned int sourceSize, unsigned char *destination,
+	unsigned int destinationCapacity, unsigned int *hashTable, unsigned int hashTableSize)
+{
+	// Positions are stored plus one, so that zero marks an empty entry.
+	memset(hashTable, 0, hashTableSize * sizeof(unsigned int));
+
+	unsigned int destinationOffset = 0;
+	unsigned int anchor = 0;
+	unsigned int position = 0;
+	unsigned int attempts = 1 << kSkipTrigger;
+
+	while (position + kMatchFindLimit <= sourceSize)
+	{
+		unsigned int sequence = libpit::PackedField<unsigned int>::Load(source + position);
+		unsigned int hash = (sequence * 2654435761U) >> 16;
+
+		unsigned int candidate = hashTable[hash];
+		hashTable[hash] = position + 1;
+
+		if (candidate == 0 || position - (candidate - 1) > kMaxMatchOffset
+			|| libpit::PackedField<unsigned int>::Load(source + candidate - 1) != sequence)
+		{
+			position += attempts++ >> kSkipTrigger;
+			continue;
+		}
+
+		unsigned int matchPosition = candidate - 1;
+		unsigned int matchLength = kMinMatchLength;
+		unsigned int maxMatchLength = sourceSize - kLastLiteralsLength - position;
+
+		while (matchLength < maxMatchLength && source[position + matchLength] == source[matchPosition + matchLength])
+			matchLength++;
+
+		if (!writeSequence(source + anchor, position - anchor, position - matchPosition, matchLength, destination,
+			destinationCapacity, destinationOffset))
+		{
+			return (0);
+		}
+
+		position += matchLength;
+		anchor = position;
+		attempts = 1 << kSkipTrigger;
+	}
+
+	// The block ends with the remaining literals alone.
+	if (!writeSequence(source + anchor, sourceSize - anchor, 0, 0, destination, destinationCapacity, destinationOffset))
+		return (0);
+
+	return (destinationOffset);
+}
+
+Lz4FrameEncoder::Lz4FrameEncoder(FILE *file)
+{
+	this->file = file;
+
+	contentSize = 0;
+	bytesEncoded = 0;
+
+	blockLength = 0;
+}
+
+bool Lz4FrameEncoder::WriteHeader(unsigned long long contentSize)
+{
+	this->contentSize = contentSize;
+
+	bytesEncoded = 0;
+	contentHash = Xxh32();
+
+	block.resize(kBlockMaxSize);
+	blockLength = 0;
+
+	compressedBlock.resize(kBlockMaxSize);
+	hashTable.resize(kHashTableSize);
+
+	unsigned char header[15];
+
+	libpit::PackedField<unsigned int>::Store(header, Lz4FrameDecoder::kMagicNumber);
+	header[4] = kFrameFlags;
+	header[5] = kBlockDescriptor;
+	libpit::PackedField<unsigned long long>::Store(header + 6, contentSize);
+
+	header[14] = (Xxh32::Hash(header + 4, 10) >> 8) & 0xFF;
+
+	return (fwrite(header, 1, sizeof(header), file) == sizeof(header));
+}
+
+bool Lz4FrameEncoder::WriteBlock(void)
+{
+	unsigned int compressedSize = compressBlock(block.data(), blockLength, compressedBlock.data(), blockLength - 1,
+		hashTable.data(), kHashTableSize);
+
+	unsigned char blockSize[4];
+	const unsigned char *blockData;
+	unsigned int blockDataSize;
+
+	if (compressedSize > 0)
+	{
+		libpit::PackedField<unsigned int>::Store(blockSize, compressedSize);
+		blockData = compressedBlock.data();
+		blockDataSize = compressedSize;
+	}
+	else
+	{
+		// Incompressible blocks are stored as they are.
+		libpit::PackedField<unsigned int>::Store(blockSize, blockLength | kBlockSizeUncompressed);
+		blockData = block.data();
+		blockDataSize = blockLength;
+	}
+
+	blockLength = 0;
+
+	return (fwrite(blockSize, 1, 4, file) == 4 && fwrite(blockData, 1, blockDataSize, file) == blockDataSize);
+}
+
+bool Lz4FrameEncoder::Write(const unsigned char *data, unsigned int length)
+{
+	if (length > contentSize - bytesEncoded)
+	{
+		Interface::PrintError("More data was written than the LZ4 frame's recorded size!\n");
+		return (false);
+	}
+
+	contentHash.Update(data, length);
+	bytesEncoded += length;
+
+	while (length > 0)
+	{
+		unsigned int count = (length < kBlockMaxSize - blockLength) ? length : kBlockMaxSize - blockLength;
+		memcpy(block.data() + blockLength, data, count);
+
+		blockLength += count;
+		data += count;
+		length -= count;
+
+		if (blockLength == kBlockMaxSize && !WriteBlock())
+			return (false);
+	}
+
+	return (true);
+}
+
+bool Lz4FrameEncoder::Finish(void)
+{
+	if (bytesEncoded != contentSize)
+	{
+		Interface::PrintError("LZ4 frame ended before its recorded size!\n");
+		return (false);
+	}
+
+	if (blockLength > 0 && !WriteBlock())
+		return (false);
+
+	unsigned char frameEnd[FrameEndLayout::kEnd];
+	FrameEndLayout::Pack(frameEnd, 0, contentHash.GetDigest());
+
+	return (fwrite(frameEnd, 1, sizeof(frameEnd), file) == sizeof(frameEnd));
+}
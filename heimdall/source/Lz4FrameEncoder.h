@@ -0,0 +1,75 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef LZ4FRAMEENCODER_H
+#define LZ4FRAMEENCODER_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <vector>
+
+// Heimdall
+#include "XxHash.h"
+
+namespace Heimdall
+{
+	// Compresses data into an LZ4 frame as it's written to a file. Frames record their uncompressed size and a checksum
+	// of their content, so they can be flashed (by way of Lz4FrameDecoder) just like Samsung's *.img.lz4 files.
+	class Lz4FrameEncoder
+	{
+		private:
+
+			enum
+			{
+				kBlockMaxSize = 4194304,
+				kHashTableSize = 65536
+			};
+
+			FILE *file;
+
+			unsigned long long contentSize;
+			unsigned long long bytesEncoded;
+
+			Xxh32 contentHash;
+
+			// Data is gathered a block at a time. Each block is compressed independently of the others.
+			std::vector<unsigned char> block;
+			unsigned int blockLength;
+
+			std::vector<unsigned char> compressedBlock;
+			std::vector<unsigned int> hashTable;
+
+			bool WriteBlock(void);
+
+		public:
+
+			Lz4FrameEncoder(FILE *file);
+
+			// Writes the frame header. Exactly contentSize bytes must then be written.
+			bool WriteHeader(unsigned long long contentSize);
+
+			bool Write(const unsigned char *data, unsigned int length);
+
+			// Writes the final block and the end of the frame.
+			bool Finish(void);
+	};
+}
+
+#endif
@@ -0,0 +1,235 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Heimdall
+#include "ArchiveVerifier.h"
+#include "Heimdall.h"
+#include "MappedFilePartSource.h"
+#include "PacketBufferPool.h"
+
+using namespace Heimdall;
+
+MappedFilePartSource::MappedFilePartSource(FILE *file, unsigned long long offset, unsigned long long length,
+	ArchiveVerifier *verifier)
+{
+	this->file = file;
+	this->verifier = verifier;
+
+	dataOffset = offset;
+	fileSize = GetRegionLength(file, offset, length);
+
+	partSize = 0;
+	partCount = 0;
+	partIndex = 0;
+
+#ifdef _WIN32
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	mappingAlignment = systemInfo.dwAllocationGranularity;
+
+	fileMappingHandle = nullptr;
+#else
+	mappingAlignment = sysconf(_SC_PAGESIZE);
+#endif
+
+	mappedAddress = nullptr;
+	mappedLength = 0;
+
+	mapping = nullptr;
+	mappingOffset = 0;
+	mappingLength = 0;
+
+	tailBuffer = nullptr;
+}
+
+MappedFilePartSource::~MappedFilePartSource()
+{
+	UnmapWindow();
+
+#ifdef _WIN32
+	if (fileMappingHandle)
+		CloseHandle(fileMappingHandle);
+#endif
+
+	if (tailBuffer)
+		PacketBufferPool::Release(tailBuffer, partSize);
+}
+
+bool MappedFilePartSource::IsMappable(FILE *file)
+{
+#ifdef _WIN32
+	HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(file));
+	LARGE_INTEGER size;
+
+	return (GetFileType(fileHandle) == FILE_TYPE_DISK && GetFileSizeEx(fileHandle, &size) && size.QuadPart > 0);
+#else
+	struct stat fileStat;
+
+	return (fstat(fileno(file), &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0);
+#endif
+}
+
+bool MappedFilePartSource::MapWindow(unsigned long long offset, unsigned long long length)
+{
+	UnmapWindow();
+
+	if (offset + length > fileSize)
+		length = fileSize - offset;
+
+	// Mappings must begin on an allocation boundary. Parts of a whole file normally do anyway, but those of an archive
+	// member needn't.
+	unsigned long long fileOffset = dataOffset + offset;
+	unsigned long long alignedOffset = fileOffset - fileOffset % mappingAlignment;
+	unsigned long long alignedLength = length + (fileOffset - alignedOffset);
+
+#ifdef _WIN32
+	void *address = MapViewOfFile(fileMappingHandle, FILE_MAP_READ, (DWORD)(alignedOffset >> 32),
+		(DWORD)(alignedOffset & 0xFFFFFFFF), (SIZE_T)alignedLength);
+
+	if (!address)
+		return (false);
+#else
+	void *address = mmap(nullptr, (size_t)alignedLength, PROT_READ, MAP_SHARED, fileno(file), (off_t)alignedOffset);
+
+	if (address == MAP_FAILED)
+		return (false);
+
+	madvise(address, (size_t)alignedLength, MADV_SEQUENTIAL);
+	madvise(address, (size_t)alignedLength, MADV_WILLNEED);
+
+#ifdef POSIX_FADV_WILLNEED
+	// Start reading the following window whilst this one is being sent.
+	posix_fadvise(fileno(file), (off_t)(fileOffset + length), (off_t)length, POSIX_FADV_WILLNEED);
+#endif
+#endif
+
+	mappedAddress = address;
+	mappedLength = (size_t)alignedLength;
+
+	mapping = static_cast<unsigned char *>(address) + (fileOffset - alignedOffset);
+	mappingOffset = offset;
+	mappingLength = (size_t)length;
+
+	return (true);
+}
+
+void MappedFilePartSource::UnmapWindow(void)
+{
+	if (!mapping)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mappedAddress);
+#else
+	munmap(mappedAddress, mappedLength);
+#endif
+
+	mappedAddress = nullptr;
+	mappedLength = 0;
+
+	mapping = nullptr;
+	mappingOffset = 0;
+	mappingLength = 0;
+}
+
+bool MappedFilePartSource::Start(unsigned int partSize)
+{
+	this->partSize = partSize;
+
+	partCount = (unsigned int)((fileSize + partSize - 1) / partSize);
+	partIndex = 0;
+
+#ifdef _WIN32
+	if (!fileMappingHandle)
+	{
+		HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(file));
+		fileMappingHandle = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (!fileMappingHandle)
+			return (false);
+	}
+#endif
+
+	return (true);
+}
+
+unsigned char *MappedFilePartSource::AcquirePart(void)
+{
+	if (partIndex >= partCount)
+		return (nullptr);
+
+	unsigned long long partOffset = (unsigned long long)partIndex * partSize;
+	unsigned long long partEnd = partOffset + partSize;
+
+	if (partEnd > fileSize)
+	{
+		// The final part is short, so must be padded.
+		if (!tailBuffer)
+		{
+			unsigned int tailSize = (unsigned int)(fileSize - partOffset);
+
+			if ((partOffset < mappingOffset || fileSize > mappingOffset + mappingLength) && !MapWindow(partOffset, tailSize))
+				return (nullptr);
+
+			tailBuffer = PacketBufferPool::Acquire(partSize);
+			memcpy(tailBuffer, mapping + (partOffset - mappingOffset), tailSize);
+
+			UnmapWindow();
+		}
+
+		return (tailBuffer);
+	}
+
+	if (!mapping || partOffset < mappingOffset || partEnd > mappingOffset + mappingLength)
+	{
+		if (!MapWindow(partOffset, (unsigned long long)kWindowPartCount * partSize))
+			return (nullptr);
+	}
+
+	return (mapping + (partOffset - mappingOffset));
+}
+
+void MappedFilePartSource::ReleasePart(void)
+{
+	if (verifier)
+	{
+		unsigned long long partOffset = (unsigned long long)partIndex * partSize;
+		unsigned int partLength = (fileSize - partOffset < partSize) ? (unsigned int)(fileSize - partOffset) : partSize;
+
+		// The part is still mapped (or held in the tail buffer), having only just been sent.
+		const unsigned char *partData = (tailBuffer) ? tailBuffer : mapping + (partOffset - mappingOffset);
+		verifier->Feed(dataOffset + partOffset, partData, partLength);
+	}
+
+	partIndex++;
+}
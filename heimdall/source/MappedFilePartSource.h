@@ -0,0 +1,99 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef MAPPEDFILEPARTSOURCE_H
+#define MAPPEDFILEPARTSOURCE_H
+
+// C/C++ Standard Library
+#include <stddef.h>
+#include <stdio.h>
+
+// Heimdall
+#include "FilePartSource.h"
+
+namespace Heimdall
+{
+	class ArchiveVerifier;
+
+	// Maps a file into memory a window at a time and hands out file parts directly from the mapping, so file data is
+	// neither copied nor held in memory beyond the current window. Only a short final part is copied, into a padded
+	// tail buffer.
+	class MappedFilePartSource : public FilePartSource
+	{
+		public:
+
+			enum
+			{
+				kWindowPartCount = 32
+			};
+
+		private:
+
+			FILE *file;
+			unsigned long long dataOffset;
+
+			// Each part is fed to the verifier (if any) once it's been sent.
+			ArchiveVerifier *verifier;
+			unsigned long long fileSize;
+			unsigned int partSize;
+			unsigned int partCount;
+			unsigned int partIndex;
+
+			unsigned int mappingAlignment;
+
+#ifdef _WIN32
+			void *fileMappingHandle;
+#endif
+
+			// The mapped window, and within it the data from mappingOffset (relative to dataOffset) onwards.
+			void *mappedAddress;
+			size_t mappedLength;
+
+			unsigned char *mapping;
+			unsigned long long mappingOffset;
+			size_t mappingLength;
+
+			unsigned char *tailBuffer;
+
+			bool MapWindow(unsigned long long offset, unsigned long long length);
+			void UnmapWindow(void);
+
+		public:
+
+			MappedFilePartSource(FILE *file, unsigned long long offset = 0, unsigned long long length = kToEndOfFile,
+				ArchiveVerifier *verifier = nullptr);
+			~MappedFilePartSource();
+
+			// Whether the file is a regular file that can be memory mapped.
+			static bool IsMappable(FILE *file);
+
+			unsigned long long GetSize(void) const
+			{
+				return (fileSize);
+			}
+
+			bool Start(unsigned int partSize);
+
+			unsigned char *AcquirePart(void);
+			void ReleasePart(void);
+	};
+}
+
+#endif
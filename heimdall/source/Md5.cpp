@@ -0,0 +1,176 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+// libpit
+#include "PackedLayout.h"
+
+// Heimdall
+#include "Md5.h"
+
+using namespace Heimdall;
+
+static const unsigned int kShifts[64] =
+{
+	7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+	5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+	4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+	6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+// floor(abs(sin(i + 1)) * 2^32)
+static const unsigned int kConstants[64] =
+{
+	0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE, 0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
+	0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE, 0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
+	0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA, 0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+	0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED, 0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
+	0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C, 0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
+	0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05, 0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+	0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039, 0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
+	0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1, 0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391
+};
+
+static inline unsigned int rotateLeft32(unsigned int value, unsigned int count)
+{
+	return ((value << count) | (value >> (32 - count)));
+}
+
+Md5::Md5()
+{
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+
+	length = 0;
+	blockLength = 0;
+}
+
+void Md5::ProcessBlock(const unsigned char *data)
+{
+	unsigned int words[16];
+
+	for (unsigned int i = 0; i < 16; i++)
+		words[i] = libpit::PackedField<unsigned int>::Load(data + i * 4);
+
+	unsigned int a = state[0];
+	unsigned int b = state[1];
+	unsigned int c = state[2];
+	unsigned int d = state[3];
+
+	for (unsigned int i = 0; i < 64; i++)
+	{
+		unsigned int f;
+		unsigned int wordIndex;
+
+		if (i < 16)
+		{
+			f = (b & c) | (~b & d);
+			wordIndex = i;
+		}
+		else if (i < 32)
+		{
+			f = (d & b) | (~d & c);
+			wordIndex = (5 * i + 1) & 15;
+		}
+		else if (i < 48)
+		{
+			f = b ^ c ^ d;
+			wordIndex = (3 * i + 5) & 15;
+		}
+		else
+		{
+			f = c ^ (b | ~d);
+			wordIndex = (7 * i) & 15;
+		}
+
+		unsigned int rotated = rotateLeft32(a + f + kConstants[i] + words[wordIndex], kShifts[i]);
+
+		a = d;
+		d = c;
+		c = b;
+		b += rotated;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+void Md5::Update(const unsigned char *data, unsigned long long length)
+{
+	this->length += length;
+
+	if (blockLength > 0)
+	{
+		unsigned int count = (length < 64 - blockLength) ? (unsigned int)length : 64 - blockLength;
+		memcpy(block + blockLength, data, count);
+
+		blockLength += count;
+		data += count;
+		length -= count;
+
+		if (blockLength < 64)
+			return;
+
+		ProcessBlock(block);
+		blockLength = 0;
+	}
+
+	while (length >= 64)
+	{
+		ProcessBlock(data);
+
+		data += 64;
+		length -= 64;
+	}
+
+	memcpy(block, data, (size_t)length);
+	blockLength = (unsigned int)length;
+}
+
+void Md5::GetDigest(unsigned char *digest) const
+{
+	// Padding is applied to a copy, so more data may still be added afterwards.
+	Md5 md5(*this);
+
+	unsigned char padding[72];
+	memset(padding, 0, sizeof(padding));
+	padding[0] = 0x80;
+
+	unsigned int paddingLength = (blockLength < 56) ? 56 - blockLength : 120 - blockLength;
+	unsigned long long bitLength = length * 8;
+
+	md5.Update(padding, paddingLength);
+
+	unsigned char lengthData[8];
+
+	for (unsigned int i = 0; i < 8; i++)
+		lengthData[i] = (bitLength >> (i * 8)) & 0xFF;
+
+	md5.Update(lengthData, 8);
+
+	for (unsigned int i = 0; i < 4; i++)
+		libpit::PackedField<unsigned int>::Store(digest + i * 4, md5.state[i]);
+}
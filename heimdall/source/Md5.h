@@ -0,0 +1,55 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef MD5_H
+#define MD5_H
+
+namespace Heimdall
+{
+	// Incremental MD5, as used for the checksums appended to Samsung's .tar.md5 firmware archives.
+	class Md5
+	{
+		public:
+
+			enum
+			{
+				kDigestSize = 16
+			};
+
+		private:
+
+			unsigned int state[4];
+			unsigned long long length;
+
+			unsigned char block[64];
+			unsigned int blockLength;
+
+			void ProcessBlock(const unsigned char *data);
+
+		public:
+
+			Md5();
+
+			void Update(const unsigned char *data, unsigned long long length);
+			void GetDigest(unsigned char *digest) const;
+	};
+}
+
+#endif
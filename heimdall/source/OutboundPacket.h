@@ -21,6 +21,9 @@
 #ifndef OUTBOUNDPACKET_H
 #define OUTBOUNDPACKET_H
 
+// libpit
+#include "PackedLayout.h"
+
 // Heimdall
 #include "Packet.h"
 
@@ -28,43 +31,15 @@ namespace Heimdall
 {
 	class OutboundPacket : public Packet
 	{
-		protected:
-
-			void PackInteger(unsigned int offset, unsigned int value)
-			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF000000) >> 24;
-				data[offset + 1] = (value & 0x00FF0000) >> 16;
-				data[offset + 2] = (value & 0x0000FF00) >> 8;
-				data[offset + 3] = value & 0x000000FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x000000FF;
-				data[offset + 1] = (value & 0x0000FF00) >> 8;
-				data[offset + 2] = (value & 0x00FF0000) >> 16;
-				data[offset + 3] = (value & 0xFF000000) >> 24;
-#endif
-			}
-
-			void PackShort(unsigned int offset, unsigned short value)
-			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF00) >> 8;
-				data[offset + 1] = value & 0x00FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x00FF;
-				data[offset + 1] = (value & 0xFF00) >> 8;
-#endif
-			}
-
 		public:
 
 			OutboundPacket(unsigned int size) : Packet(size)
 			{
 			}
 
-			virtual void Pack(void) = 0;
+			OutboundPacket(unsigned char *buffer, unsigned int size) : Packet(buffer, size)
+			{
+			}
 	};
 }
 
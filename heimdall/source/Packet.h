@@ -21,16 +21,35 @@
 #ifndef PACKET_H
 #define PACKET_H
 
-// C++ Standard Library
-#include <cstring>
+// C/C++ Standard Library
+#include <array>
+
+// Heimdall
+#include "PacketBufferPool.h"
 
 namespace Heimdall
 {
+	// Fixed size storage for packets that don't need a heap buffer. Must precede the Packet base class so that it is
+	// constructed first.
+	template <unsigned int Size>
+	class PacketStorage
+	{
+		protected:
+
+			std::array<unsigned char, Size> storage;
+
+			PacketStorage()
+			{
+				storage.fill(0);
+			}
+	};
+
 	class Packet
 	{
 		private:
 
 			unsigned int size;
+			bool ownsData;
 
 		protected:
 
@@ -41,13 +60,25 @@ namespace Heimdall
 			Packet(unsigned int size)
 			{
 				this->size = size;
-				data = new unsigned char[size];
-				memset(data, 0, size);
+				ownsData = true;
+				data = PacketBufferPool::Acquire(size);
 			}
 
+			// Wraps an existing buffer, which must outlive the packet.
+			Packet(unsigned char *buffer, unsigned int size)
+			{
+				this->size = size;
+				ownsData = false;
+				data = buffer;
+			}
+
+			Packet(const Packet&) = delete;
+			Packet& operator=(const Packet&) = delete;
+
 			~Packet()
 			{
-				delete [] data;
+				if (ownsData)
+					PacketBufferPool::Release(data, size);
 			}
 
 			unsigned int GetSize(void) const
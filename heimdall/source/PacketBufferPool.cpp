@@ -0,0 +1,94 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Heimdall
+#include "PacketBufferPool.h"
+
+using namespace std;
+using namespace Heimdall;
+
+static mutex poolMutex;
+static map< unsigned int, vector<unsigned char *> > freeBuffers;
+
+static unsigned int allocationCount = 0;
+static unsigned int reuseCount = 0;
+
+unsigned char *PacketBufferPool::Acquire(unsigned int size)
+{
+	unsigned char *buffer = nullptr;
+
+	{
+		lock_guard<mutex> lock(poolMutex);
+
+		vector<unsigned char *>& buffers = freeBuffers[size];
+
+		if (!buffers.empty())
+		{
+			buffer = buffers.back();
+			buffers.pop_back();
+			reuseCount++;
+		}
+		else
+		{
+			allocationCount++;
+		}
+	}
+
+	if (!buffer)
+		buffer = new unsigned char[size];
+
+	memset(buffer, 0, size);
+	return (buffer);
+}
+
+void PacketBufferPool::Release(unsigned char *buffer, unsigned int size)
+{
+	{
+		lock_guard<mutex> lock(poolMutex);
+
+		vector<unsigned char *>& buffers = freeBuffers[size];
+
+		if (buffers.size() < kMaxFreeBuffersPerSize)
+		{
+			buffers.push_back(buffer);
+			return;
+		}
+	}
+
+	delete [] buffer;
+}
+
+unsigned int PacketBufferPool::GetAllocationCount(void)
+{
+	lock_guard<mutex> lock(poolMutex);
+	return (allocationCount);
+}
+
+unsigned int PacketBufferPool::GetReuseCount(void)
+{
+	lock_guard<mutex> lock(poolMutex);
+	return (reuseCount);
+}
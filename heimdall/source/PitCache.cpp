@@ -0,0 +1,143 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <mutex>
+#include <stdio.h>
+
+// Heimdall
+#include "Heimdall.h"
+#include "PitCache.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+// Several devices may be flashed at once, so updates to the shared statistics file are serialised.
+static mutex statisticsMutex;
+
+PitCache::PitCache(const string& deviceKey)
+{
+	hitCount = 0;
+	missCount = 0;
+
+	if (!Utility::GetCacheFilePath(path, "pit", deviceKey, ".pit") || !Utility::GetCacheFilePath(statisticsPath, "pit", "statistics", ".txt"))
+	{
+		path.clear();
+		statisticsPath.clear();
+	}
+}
+
+void PitCache::LoadStatistics(void)
+{
+	hitCount = 0;
+	missCount = 0;
+
+	FILE *file = fopen(statisticsPath.c_str(), "r");
+
+	if (file)
+	{
+		if (fscanf(file, "hits=%u\nmisses=%u", &hitCount, &missCount) != 2)
+		{
+			hitCount = 0;
+			missCount = 0;
+		}
+
+		fclose(file);
+	}
+}
+
+unsigned int PitCache::Load(unsigned char **pitBuffer) const
+{
+	*pitBuffer = nullptr;
+
+	if (path.empty())
+		return (0);
+
+	FILE *file = fopen(path.c_str(), "rb");
+
+	if (!file)
+		return (0);
+
+	FileSeek(file, 0, SEEK_END);
+	long long fileSize = FileTell(file);
+	FileRewind(file);
+
+	// Anything this large can't be a PIT file.
+	if (fileSize <= 0 || fileSize > 1048576)
+	{
+		fclose(file);
+		return (0);
+	}
+
+	unsigned char *buffer = new unsigned char[(unsigned int)fileSize];
+
+	if (fread(buffer, 1, (size_t)fileSize, file) != (size_t)fileSize)
+	{
+		delete [] buffer;
+		fclose(file);
+		return (0);
+	}
+
+	fclose(file);
+
+	*pitBuffer = buffer;
+	return ((unsigned int)fileSize);
+}
+
+bool PitCache::Store(const unsigned char *pitBuffer, unsigned int pitFileSize) const
+{
+	if (path.empty())
+		return (false);
+
+	return (Utility::WriteFileAtomically(path, "wb", [pitBuffer, pitFileSize](FILE *file)
+	{
+		return (fwrite(pitBuffer, 1, pitFileSize, file) == pitFileSize);
+	}));
+}
+
+void PitCache::Remove(void) const
+{
+	if (!path.empty())
+		remove(path.c_str());
+}
+
+void PitCache::RecordResult(bool hit)
+{
+	if (statisticsPath.empty())
+		return;
+
+	lock_guard<mutex> lock(statisticsMutex);
+
+	LoadStatistics();
+
+	if (hit)
+		hitCount++;
+	else
+		missCount++;
+
+	FILE *file = fopen(statisticsPath.c_str(), "w");
+
+	if (file)
+	{
+		fprintf(file, "hits=%u\nmisses=%u\n", hitCount, missCount);
+		fclose(file);
+	}
+}
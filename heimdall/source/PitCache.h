@@ -0,0 +1,68 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef PITCACHE_H
+#define PITCACHE_H
+
+// C/C++ Standard Library
+#include <string>
+
+namespace Heimdall
+{
+	// Copies of device PIT files kept in the cache directory, keyed by device serial number, so that a
+	// flash can verify a cached PIT against the device rather than download it in full.
+	class PitCache
+	{
+		private:
+
+			std::string path;
+			std::string statisticsPath;
+
+			unsigned int hitCount;
+			unsigned int missCount;
+
+			void LoadStatistics(void);
+
+		public:
+
+			PitCache(const std::string& deviceKey);
+
+			// Returns the size of the cached PIT file, or 0 if there isn't one. The buffer must be deleted by the caller.
+			unsigned int Load(unsigned char **pitBuffer) const;
+			bool Store(const unsigned char *pitBuffer, unsigned int pitFileSize) const;
+			void Remove(void) const;
+
+			// Hit and miss counts are accumulated across all devices and runs, and are available once a result has been
+			// recorded.
+			void RecordResult(bool hit);
+
+			unsigned int GetHitCount(void) const
+			{
+				return (hitCount);
+			}
+
+			unsigned int GetMissCount(void) const
+			{
+				return (missCount);
+			}
+	};
+}
+
+#endif
@@ -26,7 +26,7 @@
 
 namespace Heimdall
 {
-	class ReceiveFilePartPacket : public InboundPacket
+	class ReceiveFilePartPacket : private PacketStorage<500>, public InboundPacket
 	{
 		public:
 
@@ -35,7 +35,13 @@ namespace Heimdall
 				kDataSize = 500
 			};
 
-			ReceiveFilePartPacket() : InboundPacket(kDataSize, true)
+			ReceiveFilePartPacket() : InboundPacket(storage.data(), kDataSize, true)
+			{
+			}
+
+			// Receives directly into the caller's buffer, which may be larger than a single part should the device send
+			// more than kDataSize bytes at once.
+			ReceiveFilePartPacket(unsigned char *buffer, unsigned int size) : InboundPacket(buffer, size, true)
 			{
 			}
 
@@ -26,7 +26,7 @@
 
 namespace Heimdall
 {
-	class ResponsePacket : public InboundPacket
+	class ResponsePacket : private PacketStorage<8>, public InboundPacket
 	{
 		public:
 
@@ -45,14 +45,17 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::PackedLayout<0, unsigned int> Layout;
+
 			enum
 			{
-				kDataSize = 4
+				kSize = 8,
+				kDataSize = Layout::kEnd
 			};
 
 		public:
 
-			ResponsePacket(int responseType) : InboundPacket(8)
+			ResponsePacket(int responseType) : InboundPacket(storage.data(), kSize)
 			{
 				this->responseType = responseType;
 			}
@@ -62,9 +65,11 @@ namespace Heimdall
 				return (responseType);
 			}
 
-			virtual bool Unpack(void)
+			bool Unpack(void)
 			{
-				unsigned int receivedResponseType = UnpackInteger(0);
+				unsigned int receivedResponseType;
+				Layout::Unpack(data, receivedResponseType);
+
 				if (receivedResponseType != responseType)
 				{
 					responseType = receivedResponseType;
@@ -21,12 +21,8 @@
 #ifndef SENDFILEPARTPACKET_H
 #define SENDFILEPARTPACKET_H
 
-// C Standard Library
-#include <stdio.h>
-#include <string.h>
-
 // Heimdall
-#include "Packet.h"
+#include "OutboundPacket.h"
 
 namespace Heimdall
 {
@@ -34,24 +30,9 @@ namespace Heimdall
 	{
 		public:
 
-			SendFilePartPacket(FILE *file, unsigned int size) : OutboundPacket(size)
-			{
-				memset(data, 0, size);
-
-				unsigned int position = (unsigned int)FileTell(file);
-
-				FileSeek(file, 0, SEEK_END);
-				unsigned int fileSize = (unsigned int)FileTell(file);
-				FileSeek(file, position, SEEK_SET);
-
-				// min(fileSize, size)
-				unsigned int bytesToRead = (fileSize < size) ? fileSize - position : size;
-				(void)fread(data, 1, bytesToRead, file);
-			}
-
-			SendFilePartPacket(unsigned char *buffer, unsigned int size) : OutboundPacket(size)
+			// The packet refers directly to the caller's buffer, so file parts are sent without being copied.
+			SendFilePartPacket(unsigned char *buffer, unsigned int size) : OutboundPacket(buffer, size)
 			{
-				memcpy(data, buffer, size);
 			}
 
 			void Pack(void)
@@ -0,0 +1,148 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef SEQUENCELENGTHTUNER_H
+#define SEQUENCELENGTHTUNER_H
+
+// C/C++ Standard Library
+#include <vector>
+
+namespace Heimdall
+{
+	// Chooses how many file parts are sent per sequence. Each candidate length is trialled on a complete sequence, after
+	// which the length that achieved the greatest throughput is used. A tuner with a single candidate simply always
+	// returns that length.
+	class SequenceLengthTuner
+	{
+		private:
+
+			struct Candidate
+			{
+				unsigned int length;
+				unsigned long long byteCount;
+				unsigned long long milliseconds;
+
+				Candidate(unsigned int length)
+				{
+					this->length = length;
+					byteCount = 0;
+					milliseconds = 0;
+				}
+			};
+
+			std::vector<Candidate> candidates;
+
+			unsigned int GetBestCandidateIndex(void) const
+			{
+				unsigned int bestIndex = 0;
+				double bestThroughput = 0.0;
+
+				for (unsigned int i = 0; i < candidates.size(); i++)
+				{
+					if (candidates[i].milliseconds == 0)
+						continue;
+
+					double throughput = (double)candidates[i].byteCount / (double)candidates[i].milliseconds;
+
+					if (throughput > bestThroughput)
+					{
+						bestIndex = i;
+						bestThroughput = throughput;
+					}
+				}
+
+				return (bestIndex);
+			}
+
+		public:
+
+			SequenceLengthTuner(unsigned int length = 1)
+			{
+				candidates.push_back(Candidate(length));
+			}
+
+			// Trials a quarter, half and all of the maximum sequence length.
+			static SequenceLengthTuner CreateAutotuning(unsigned int maxLength)
+			{
+				SequenceLengthTuner tuner(maxLength / 4 > 0 ? maxLength / 4 : 1);
+
+				if (maxLength / 2 > tuner.candidates.back().length)
+					tuner.candidates.push_back(Candidate(maxLength / 2));
+
+				if (maxLength > tuner.candidates.back().length)
+					tuner.candidates.push_back(Candidate(maxLength));
+
+				return (tuner);
+			}
+
+			bool IsTuned(void) const
+			{
+				if (candidates.size() == 1)
+					return (true);
+
+				for (unsigned int i = 0; i < candidates.size(); i++)
+				{
+					if (candidates[i].milliseconds == 0)
+						return (false);
+				}
+
+				return (true);
+			}
+
+			unsigned int GetSequenceLength(void) const
+			{
+				for (unsigned int i = 0; i < candidates.size(); i++)
+				{
+					if (candidates[i].milliseconds == 0)
+						return (candidates[i].length);
+				}
+
+				return (candidates[GetBestCandidateIndex()].length);
+			}
+
+			// Throughput of the best length measured so far, in KiB/s.
+			unsigned int GetThroughput(void) const
+			{
+				const Candidate& candidate = candidates[GetBestCandidateIndex()];
+
+				if (candidate.milliseconds == 0)
+					return (0);
+
+				return ((unsigned int)(candidate.byteCount * 1000 / 1024 / candidate.milliseconds));
+			}
+
+			// Records the time taken to send a complete sequence. Sequences cut short by the end of a file aren't
+			// representative, so shouldn't be recorded.
+			void RecordSequence(unsigned int length, unsigned int byteCount, unsigned long long milliseconds)
+			{
+				for (unsigned int i = 0; i < candidates.size(); i++)
+				{
+					if (candidates[i].length == length)
+					{
+						candidates[i].byteCount += byteCount;
+						candidates[i].milliseconds += (milliseconds > 0) ? milliseconds : 1;
+						break;
+					}
+				}
+			}
+	};
+}
+
+#endif
@@ -46,9 +46,13 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::PackedLayout<ControlPacket::kDataSize, unsigned int> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 			enum
 			{
-				kDataSize = ControlPacket::kDataSize + 4
+				kDataSize = Layout::kEnd
 			};
 
 		public:
@@ -67,7 +71,7 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				Layout::Pack(data, request);
 			}
 	};
 }
@@ -0,0 +1,283 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+// Heimdall
+#include "ArchiveVerifier.h"
+#include "FileDecoder.h"
+#include "FilePartReader.h"
+#include "Heimdall.h"
+#include "PacketBufferPool.h"
+#include "SharedFilePartReader.h"
+
+using namespace std;
+using namespace Heimdall;
+
+SharedFilePartReader::SharedFilePartReader(FILE *file, unsigned long long offset, unsigned long long length,
+	unsigned int consumerCount, ArchiveVerifier *verifier, unsigned int bufferCount)
+{
+	this->file = file;
+	this->verifier = verifier;
+	this->bufferCount = bufferCount;
+
+	fileOffset = offset;
+	fileLength = FilePartSource::GetRegionLength(file, offset, length);
+
+	readFailed = !FileDecoder::Open(file, offset, verifier, &decoder);
+
+	if (decoder)
+	{
+		fileSize = decoder->GetContentSize();
+	}
+	else
+	{
+		fileSize = fileLength;
+		FileSeek(file, offset, SEEK_SET);
+	}
+
+	partSize = 0;
+	partCount = 0;
+
+	partsReleased.resize(consumerCount, 0);
+	detached.resize(consumerCount, false);
+
+	partsRead = 0;
+	bytesRead = 0;
+	stopping = false;
+}
+
+SharedFilePartReader::~SharedFilePartReader()
+{
+	{
+		lock_guard<mutex> lock(partMutex);
+		stopping = true;
+	}
+
+	partReleasedCondition.notify_all();
+
+	if (readerThread.joinable())
+		readerThread.join();
+
+	delete decoder;
+
+	for (unsigned int i = 0; i < buffers.size(); i++)
+		PacketBufferPool::Release(buffers[i], partSize);
+}
+
+bool SharedFilePartReader::IsHeldBack(unsigned int partIndex) const
+{
+	// The buffer for this part is still in use if any attached consumer hasn't released the part it previously held.
+	for (unsigned int i = 0; i < partsReleased.size(); i++)
+	{
+		if (!detached[i] && partIndex - partsReleased[i] >= bufferCount)
+			return (true);
+	}
+
+	return (false);
+}
+
+void SharedFilePartReader::ReadParts(void)
+{
+	unsigned long long bytesRemaining = fileSize;
+	unsigned long long position = fileOffset;
+
+	for (unsigned int partIndex = 0; partIndex < partCount; partIndex++)
+	{
+		{
+			unique_lock<mutex> lock(partMutex);
+
+			while (!stopping && IsHeldBack(partIndex))
+				partReleasedCondition.wait(lock);
+
+			if (stopping)
+				return;
+		}
+
+		// The buffer is exclusively ours until partsRead is incremented.
+		unsigned char *buffer = buffers[partIndex % bufferCount];
+		unsigned int bytesToRead = (bytesRemaining < partSize) ? (unsigned int)bytesRemaining : partSize;
+
+		if (bytesToRead < partSize)
+			memset(buffer + bytesToRead, 0, partSize - bytesToRead);
+
+		bool success;
+
+		if (decoder)
+		{
+			success = decoder->Read(buffer, bytesToRead);
+		}
+		else
+		{
+			success = fread(buffer, 1, bytesToRead, file) == bytesToRead;
+
+			if (success && verifier)
+				verifier->Feed(position, buffer, bytesToRead);
+
+			position += bytesToRead;
+		}
+
+		bytesRemaining -= bytesToRead;
+
+		{
+			lock_guard<mutex> lock(partMutex);
+
+			if (success)
+			{
+				partsRead++;
+				bytesRead += bytesToRead;
+			}
+			else
+			{
+				readFailed = true;
+			}
+		}
+
+		partReadCondition.notify_all();
+
+		if (!success)
+			return;
+	}
+}
+
+bool SharedFilePartReader::Start(unsigned int consumer, unsigned int partSize)
+{
+	lock_guard<mutex> lock(partMutex);
+
+	// A detached consumer may have been the last one holding the reader back, so it can't rejoin.
+	if (readFailed || consumer >= detached.size() || detached[consumer])
+		return (false);
+
+	if (this->partSize != 0)
+		return (partSize == this->partSize);
+
+	this->partSize = partSize;
+
+	partCount = (unsigned int)((fileSize + partSize - 1) / partSize);
+
+	if (bufferCount > partCount)
+		bufferCount = (partCount > 0) ? partCount : 1;
+
+	buffers.resize(bufferCount);
+
+	for (unsigned int i = 0; i < bufferCount; i++)
+		buffers[i] = PacketBufferPool::Acquire(partSize);
+
+	readerThread = thread(&SharedFilePartReader::ReadParts, this);
+	return (true);
+}
+
+unsigned char *SharedFilePartReader::AcquirePart(unsigned int consumer)
+{
+	unique_lock<mutex> lock(partMutex);
+
+	if (partsReleased[consumer] == partCount)
+		return (nullptr);
+
+	while (partsRead == partsReleased[consumer] && !readFailed)
+		partReadCondition.wait(lock);
+
+	if (partsRead == partsReleased[consumer])
+		return (nullptr);
+
+	return (buffers[partsReleased[consumer] % bufferCount]);
+}
+
+void SharedFilePartReader::ReleasePart(unsigned int consumer)
+{
+	{
+		lock_guard<mutex> lock(partMutex);
+		partsReleased[consumer]++;
+	}
+
+	partReleasedCondition.notify_one();
+}
+
+void SharedFilePartReader::Detach(unsigned int consumer)
+{
+	{
+		lock_guard<mutex> lock(partMutex);
+
+		if (consumer >= detached.size())
+			return;
+
+		detached[consumer] = true;
+
+		bool allDetached = true;
+
+		for (unsigned int i = 0; i < detached.size(); i++)
+			allDetached = allDetached && detached[i];
+
+		// Nobody is left to read for.
+		if (allDetached)
+			stopping = true;
+	}
+
+	partReleasedCondition.notify_one();
+}
+
+unsigned long long SharedFilePartReader::GetBytesRead(void)
+{
+	lock_guard<mutex> lock(partMutex);
+	return (bytesRead);
+}
+
+SharedFilePartSource::SharedFilePartSource(SharedFilePartReader *reader, unsigned int consumer, FILE *fallbackFile)
+{
+	this->reader = reader;
+	this->consumer = consumer;
+	this->fallbackFile = fallbackFile;
+
+	fallbackSource = nullptr;
+}
+
+SharedFilePartSource::~SharedFilePartSource()
+{
+	reader->Detach(consumer);
+	delete fallbackSource;
+}
+
+bool SharedFilePartSource::Start(unsigned int partSize)
+{
+	if (reader->Start(consumer, partSize))
+		return (true);
+
+	reader->Detach(consumer);
+
+	fallbackSource = new FilePartReader(fallbackFile, reader->GetFileOffset(), reader->GetFileLength(), reader->GetVerifier());
+	return (fallbackSource->Start(partSize));
+}
+
+unsigned char *SharedFilePartSource::AcquirePart(void)
+{
+	if (fallbackSource)
+		return (fallbackSource->AcquirePart());
+
+	return (reader->AcquirePart(consumer));
+}
+
+void SharedFilePartSource::ReleasePart(void)
+{
+	if (fallbackSource)
+		fallbackSource->ReleasePart();
+	else
+		reader->ReleasePart(consumer);
+}
@@ -0,0 +1,156 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef SHAREDFILEPARTREADER_H
+#define SHAREDFILEPARTREADER_H
+
+// C/C++ Standard Library
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// Heimdall
+#include "FilePartSource.h"
+
+namespace Heimdall
+{
+	// Reads a file once on a background thread into a ring of part buffers shared by several consumers (e.g. one per
+	// device being flashed with the same file). A buffer is only reused once every consumer has released it, so the
+	// slowest consumer holds back the reader, whilst faster consumers may run up to a ring's length ahead of it.
+	class ArchiveVerifier;
+	class FileDecoder;
+
+	class SharedFilePartReader
+	{
+		public:
+
+			enum
+			{
+				kDefaultBufferCount = 16
+			};
+
+		private:
+
+			FILE *file;
+			unsigned long long fileOffset;
+			unsigned long long fileLength;
+			unsigned long long fileSize;
+
+			// Decodes LZ4 compressed files and sparse images as they're read.
+			FileDecoder *decoder;
+
+			// Data is fed to the verifier (if any) as it's read from the file.
+			ArchiveVerifier *verifier;
+			unsigned int partSize;
+			unsigned int partCount;
+
+			unsigned int bufferCount;
+			std::vector<unsigned char *> buffers;
+
+			std::mutex partMutex;
+			std::condition_variable partReadCondition;
+			std::condition_variable partReleasedCondition;
+
+			// Consumers that have finished, or given up, are detached and no longer hold back the reader.
+			std::vector<unsigned int> partsReleased;
+			std::vector<bool> detached;
+
+			unsigned int partsRead;
+			unsigned long long bytesRead;
+			bool readFailed;
+			bool stopping;
+
+			std::thread readerThread;
+
+			bool IsHeldBack(unsigned int partIndex) const;
+			void ReadParts(void);
+
+		public:
+
+			// Reads length bytes from offset within the file, or to the end of the file if length is
+			// FilePartSource::kToEndOfFile.
+			SharedFilePartReader(FILE *file, unsigned long long offset, unsigned long long length, unsigned int consumerCount,
+				ArchiveVerifier *verifier = nullptr, unsigned int bufferCount = kDefaultBufferCount);
+			~SharedFilePartReader();
+
+			unsigned long long GetSize(void) const
+			{
+				return (fileSize);
+			}
+
+			// The region of the file being read, which may be compressed.
+			unsigned long long GetFileOffset(void) const
+			{
+				return (fileOffset);
+			}
+
+			unsigned long long GetFileLength(void) const
+			{
+				return (fileLength);
+			}
+
+			ArchiveVerifier *GetVerifier(void) const
+			{
+				return (verifier);
+			}
+
+			// The first consumer to start determines the part size. Returns false if a consumer requests a different
+			// part size, or has already detached.
+			bool Start(unsigned int consumer, unsigned int partSize);
+
+			unsigned char *AcquirePart(unsigned int consumer);
+			void ReleasePart(unsigned int consumer);
+			void Detach(unsigned int consumer);
+
+			unsigned long long GetBytesRead(void);
+	};
+
+	// A single consumer's view of a SharedFilePartReader. Should the consumer need a different part size, it falls back
+	// to reading its own copy of the file.
+	class SharedFilePartSource : public FilePartSource
+	{
+		private:
+
+			SharedFilePartReader *reader;
+			unsigned int consumer;
+
+			FILE *fallbackFile;
+			FilePartSource *fallbackSource;
+
+		public:
+
+			SharedFilePartSource(SharedFilePartReader *reader, unsigned int consumer, FILE *fallbackFile);
+			~SharedFilePartSource();
+
+			unsigned long long GetSize(void) const
+			{
+				return (reader->GetSize());
+			}
+
+			bool Start(unsigned int partSize);
+
+			unsigned char *AcquirePart(void);
+			void ReleasePart(void);
+	};
+}
+
+#endif
@@ -0,0 +1,315 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+// libpit
+#include "PackedLayout.h"
+
+// Heimdall
+#include "ArchiveVerifier.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "SparseImageDecoder.h"
+
+using namespace Heimdall;
+
+// Magic number, major and minor version, header size, chunk header size, block size, total blocks and total chunks.
+// The image checksum that follows is never used.
+typedef libpit::PackedLayout<0, unsigned int, unsigned short, unsigned short, unsigned short, unsigned short,
+	unsigned int, unsigned int, unsigned int> SparseHeaderLayout;
+
+// Chunk type, reserved, block count and total size.
+typedef libpit::PackedLayout<0, unsigned short, unsigned short, unsigned int, unsigned int> ChunkHeaderLayout;
+
+static_assert(SparseHeaderLayout::kEnd <= SparseImageDecoder::kHeaderSize, "Sparse header layout is too large");
+static_assert(ChunkHeaderLayout::kEnd == SparseImageDecoder::kChunkHeaderSize, "Chunk header layout is the wrong size");
+
+SparseImageDecoder::SparseImageDecoder(FILE *file, unsigned long long offset, ArchiveVerifier *verifier, FileDecoder *source)
+{
+	this->file = file;
+	this->offset = offset;
+	this->verifier = verifier;
+	this->source = source;
+
+	position = offset;
+
+	headerSize = 0;
+	chunkHeaderSize = 0;
+	blockSize = 0;
+	totalBlocks = 0;
+	totalChunks = 0;
+
+	contentSize = 0;
+	bytesDecoded = 0;
+
+	chunksRead = 0;
+	blocksRead = 0;
+
+	chunkType = 0;
+	chunkBytesRemaining = 0;
+	memset(fillValue, 0, sizeof(fillValue));
+}
+
+SparseImageDecoder::~SparseImageDecoder()
+{
+	delete source;
+}
+
+bool SparseImageDecoder::IsSparseFile(FILE *file, unsigned long long offset)
+{
+	FileSeek(file, offset, SEEK_SET);
+
+	unsigned char magicNumber[4];
+	bool isSparseFile = fread(magicNumber, 1, 4, file) == 4 && libpit::PackedField<unsigned int>::Load(magicNumber) == kMagicNumber;
+
+	FileRewind(file);
+
+	return (isSparseFile);
+}
+
+bool SparseImageDecoder::ReadData(unsigned char *data, unsigned int length)
+{
+	if (source)
+		return (source->Read(data, length));
+
+	if (fread(data, 1, length, file) != length)
+		return (false);
+
+	if (verifier)
+		verifier->Feed(position, data, length);
+
+	position += length;
+	return (true);
+}
+
+bool SparseImageDecoder::SkipData(unsigned int length)
+{
+	unsigned char data[64];
+
+	while (length > 0)
+	{
+		unsigned int count = (length < sizeof(data)) ? length : (unsigned int)sizeof(data);
+
+		if (!ReadData(data, count))
+			return (false);
+
+		length -= count;
+	}
+
+	return (true);
+}
+
+bool SparseImageDecoder::ReadHeader(void)
+{
+	if (!source)
+	{
+		FileSeek(file, offset, SEEK_SET);
+		position = offset;
+	}
+
+	unsigned char header[kHeaderSize];
+
+	if (!ReadData(header, kHeaderSize))
+	{
+		Interface::PrintError("Failed to read sparse image header!\n");
+		return (false);
+	}
+
+	unsigned int magicNumber;
+	unsigned short majorVersion, minorVersion, fileHeaderSize, fileChunkHeaderSize;
+
+	SparseHeaderLayout::Unpack(header, magicNumber, majorVersion, minorVersion, fileHeaderSize, fileChunkHeaderSize,
+		blockSize, totalBlocks, totalChunks);
+
+	if (magicNumber != kMagicNumber)
+	{
+		Interface::PrintError("Failed to read sparse image header!\n");
+		return (false);
+	}
+
+	headerSize = fileHeaderSize;
+	chunkHeaderSize = fileChunkHeaderSize;
+
+	if (majorVersion != 1)
+	{
+		Interface::PrintError("Unsupported sparse image version!\n");
+		return (false);
+	}
+
+	if (headerSize < kHeaderSize || chunkHeaderSize < kChunkHeaderSize || blockSize == 0 || blockSize % 4 != 0)
+	{
+		Interface::PrintError("Sparse image header is corrupt!\n");
+		return (false);
+	}
+
+	// Later versions of the format may extend the headers.
+	if (!SkipData(headerSize - kHeaderSize))
+	{
+		Interface::PrintError("Failed to read sparse image header!\n");
+		return (false);
+	}
+
+	contentSize = (unsigned long long)totalBlocks * blockSize;
+	bytesDecoded = 0;
+
+	chunksRead = 0;
+	blocksRead = 0;
+
+	chunkType = 0;
+	chunkBytesRemaining = 0;
+
+	return (true);
+}
+
+bool SparseImageDecoder::ReadChunkHeader(void)
+{
+	if (chunksRead == totalChunks)
+	{
+		Interface::PrintError("Sparse image ended before its recorded size!\n");
+		return (false);
+	}
+
+	unsigned char header[kChunkHeaderSize];
+
+	if (!ReadData(header, kChunkHeaderSize) || !SkipData(chunkHeaderSize - kChunkHeaderSize))
+	{
+		Interface::PrintError("Failed to read sparse image chunk!\n");
+		return (false);
+	}
+
+	chunksRead++;
+
+	unsigned short type, reserved;
+	unsigned int chunkBlocks, chunkSize;
+
+	ChunkHeaderLayout::Unpack(header, type, reserved, chunkBlocks, chunkSize);
+	chunkType = type;
+
+	unsigned long long chunkBytes = (unsigned long long)chunkBlocks * blockSize;
+	bool valid = chunkSize >= chunkHeaderSize && blocksRead + chunkBlocks <= totalBlocks;
+
+	// The size includes the chunk header.
+	unsigned int dataSize = chunkSize - chunkHeaderSize;
+
+	switch (chunkType)
+	{
+		case kChunkTypeRaw:
+			valid = valid && dataSize == chunkBytes;
+			break;
+
+		case kChunkTypeFill:
+			valid = valid && dataSize == sizeof(fillValue) && ReadData(fillValue, sizeof(fillValue));
+			break;
+
+		case kChunkTypeDontCare:
+			valid = valid && dataSize == 0;
+			break;
+
+		case kChunkTypeCrc32:
+			// The checksum of the preceding data, which the device has no use for.
+			valid = valid && chunkBlocks == 0 && dataSize == 4 && SkipData(dataSize);
+			break;
+
+		default:
+			valid = false;
+			break;
+	}
+
+	if (!valid)
+	{
+		Interface::PrintError("Sparse image chunk is corrupt!\n");
+		return (false);
+	}
+
+	blocksRead += chunkBlocks;
+	chunkBytesRemaining = chunkBytes;
+
+	return (true);
+}
+
+bool SparseImageDecoder::EndImage(void)
+{
+	// Only checksum (or empty) chunks may follow the last of the data.
+	while (chunksRead < totalChunks)
+	{
+		if (!ReadChunkHeader())
+			return (false);
+
+		if (chunkBytesRemaining > 0)
+		{
+			Interface::PrintError("Sparse image is longer than its recorded size!\n");
+			return (false);
+		}
+	}
+
+	return (true);
+}
+
+bool SparseImageDecoder::Read(unsigned char *buffer, unsigned int length)
+{
+	if (length > contentSize - bytesDecoded)
+		return (false);
+
+	while (length > 0)
+	{
+		while (chunkBytesRemaining == 0)
+		{
+			if (!ReadChunkHeader())
+				return (false);
+		}
+
+		unsigned int count = (chunkBytesRemaining < length) ? (unsigned int)chunkBytesRemaining : length;
+
+		if (chunkType == kChunkTypeRaw)
+		{
+			if (!ReadData(buffer, count))
+			{
+				Interface::PrintError("Failed to read sparse image chunk!\n");
+				return (false);
+			}
+		}
+		else if (chunkType == kChunkTypeFill && (fillValue[0] != fillValue[1] || fillValue[0] != fillValue[2]
+			|| fillValue[0] != fillValue[3]))
+		{
+			// Chunks are a whole number of blocks, and blocks a multiple of 4 bytes, so the pattern is aligned with
+			// the image.
+			for (unsigned int i = 0; i < count; i++)
+				buffer[i] = fillValue[(bytesDecoded + i) % 4];
+		}
+		else
+		{
+			// Don't care chunks are expanded to zeros, as they would be by simg2img.
+			memset(buffer, (chunkType == kChunkTypeFill) ? fillValue[0] : 0, count);
+		}
+
+		chunkBytesRemaining -= count;
+		buffer += count;
+		length -= count;
+		bytesDecoded += count;
+	}
+
+	// Check the end of the image now, rather than waiting for a read that'll never come.
+	if (bytesDecoded == contentSize && !EndImage())
+		return (false);
+
+	return (true);
+}
@@ -0,0 +1,111 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef SPARSEIMAGEDECODER_H
+#define SPARSEIMAGEDECODER_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "FileDecoder.h"
+
+namespace Heimdall
+{
+	// Expands an Android sparse image (e.g. system.img, vendor.img, userdata.img) as it's read. Fill and "don't care"
+	// chunks are synthesised rather than read, so the image is never expanded on disk.
+	class SparseImageDecoder : public FileDecoder
+	{
+		public:
+
+			static const unsigned int kMagicNumber = 0xED26FF3A;
+
+			enum
+			{
+				kHeaderSize = 28,
+				kChunkHeaderSize = 12
+			};
+
+		private:
+
+			enum
+			{
+				kChunkTypeRaw = 0xCAC1,
+				kChunkTypeFill = 0xCAC2,
+				kChunkTypeDontCare = 0xCAC3,
+				kChunkTypeCrc32 = 0xCAC4
+			};
+
+			FILE *file;
+			unsigned long long offset;
+
+			// Data read from the file is fed to the verifier (if any).
+			ArchiveVerifier *verifier;
+			unsigned long long position;
+
+			// Compressed images are read through the decoder that decompresses them, rather than from the file directly.
+			FileDecoder *source;
+
+			unsigned int headerSize;
+			unsigned int chunkHeaderSize;
+			unsigned int blockSize;
+			unsigned int totalBlocks;
+			unsigned int totalChunks;
+
+			unsigned long long contentSize;
+			unsigned long long bytesDecoded;
+
+			unsigned int chunksRead;
+			unsigned long long blocksRead;
+
+			unsigned int chunkType;
+			unsigned long long chunkBytesRemaining;
+			unsigned char fillValue[4];
+
+			bool ReadData(unsigned char *data, unsigned int length);
+			bool SkipData(unsigned int length);
+
+			bool ReadChunkHeader(void);
+			bool EndImage(void);
+
+		public:
+
+			// The image begins at offset within the file, or at the current position of source if one is given. The
+			// source (whose header must already have been read) is deleted along with the decoder.
+			SparseImageDecoder(FILE *file, unsigned long long offset = 0, ArchiveVerifier *verifier = nullptr,
+				FileDecoder *source = nullptr);
+			~SparseImageDecoder();
+
+			// Checks for the sparse image magic number at offset, leaving the file rewound.
+			static bool IsSparseFile(FILE *file, unsigned long long offset = 0);
+
+			bool ReadHeader(void);
+
+			// The size of the expanded image, as given by its block count.
+			unsigned long long GetContentSize(void) const
+			{
+				return (contentSize);
+			}
+
+			bool Read(unsigned char *buffer, unsigned int length);
+	};
+}
+
+#endif
@@ -0,0 +1,48 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Heimdall
+#include "FlashAction.h"
+#include "Heimdall.h"
+#include "StationAction.h"
+
+using namespace Heimdall;
+
+const char *StationAction::usage = "Action: station\n\
+Arguments:\n\
+    [--<partition name> <filename> ...]\n\
+    [--<partition identifier> <filename> ...]\n\
+    [--archive <filename>[,<filename>...]]\n\
+    [--pit <filename>] [--repartition] [--count <number>] [--verbose]\n\
+    [--no-reboot] [--stdout-errors] [--usb-log-level <none/error/warning/debug>]\n\
+    [--usb-transfer-mode <sync/async>] [--autotune] [--calibrate-empty-transfers]\n\
+    [--no-pit-cache] [--tflash] [--skip-unchanged] [--no-delay]\n\
+    [--expand-sparse] [--throughput <MiB/s>]\n\
+Description: Runs as a flashing station, flashing the specified files to each\n\
+    download mode device as soon as it's connected, until interrupted with\n\
+    Ctrl+C or --count devices have been flashed. The arguments are otherwise\n\
+    the same as for the flash action. Output from each device is prefixed with\n\
+    its USB location, along with the time from the device being connected to\n\
+    flashing starting, and how long flashing took.\n";
+
+int StationAction::Execute(int argc, char **argv)
+{
+	return (FlashAction::ExecuteStation(argc, argv));
+}
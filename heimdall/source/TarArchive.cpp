@@ -0,0 +1,268 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstdlib>
+#include <cstring>
+
+// Heimdall
+#include "Heimdall.h"
+#include "Interface.h"
+#include "TarArchive.h"
+
+using namespace std;
+using namespace Heimdall;
+
+enum
+{
+	kTarBlockSize = 512
+};
+
+enum
+{
+	kTarHeaderNameOffset = 0,
+	kTarHeaderNameLength = 100,
+	kTarHeaderSizeOffset = 124,
+	kTarHeaderSizeLength = 12,
+	kTarHeaderChecksumOffset = 148,
+	kTarHeaderChecksumLength = 8,
+	kTarHeaderTypeOffset = 156,
+	kTarHeaderMagicOffset = 257,
+	kTarHeaderPrefixOffset = 345,
+	kTarHeaderPrefixLength = 155
+};
+
+static string readHeaderString(const unsigned char *header, unsigned int offset, unsigned int length)
+{
+	const char *field = reinterpret_cast<const char *>(header + offset);
+	return (string(field, strnlen(field, length)));
+}
+
+static unsigned long long readHeaderNumber(const unsigned char *header, unsigned int offset, unsigned int length)
+{
+	unsigned long long value = 0;
+
+	if (header[offset] & 0x80)
+	{
+		// GNU base-256 encoding, for sizes too large to be written in octal.
+		for (unsigned int i = 1; i < length; i++)
+			value = (value << 8) | header[offset + i];
+
+		return (value);
+	}
+
+	for (unsigned int i = 0; i < length; i++)
+	{
+		unsigned char c = header[offset + i];
+
+		if (c >= '0' && c <= '7')
+			value = (value << 3) | (c - '0');
+		else if (c != ' ' || value != 0)
+			break;
+	}
+
+	return (value);
+}
+
+static bool isHeaderValid(const unsigned char *header)
+{
+	unsigned int checksum = 0;
+
+	for (unsigned int i = 0; i < kTarBlockSize; i++)
+	{
+		if (i >= kTarHeaderChecksumOffset && i < kTarHeaderChecksumOffset + kTarHeaderChecksumLength)
+			checksum += ' ';
+		else
+			checksum += header[i];
+	}
+
+	return (checksum == readHeaderNumber(header, kTarHeaderChecksumOffset, kTarHeaderChecksumLength));
+}
+
+static bool isBlockEmpty(const unsigned char *block)
+{
+	for (unsigned int i = 0; i < kTarBlockSize; i++)
+	{
+		if (block[i] != 0)
+			return (false);
+	}
+
+	return (true);
+}
+
+static bool readExtendedData(FILE *file, unsigned long long size, string& data)
+{
+	// Extended headers are small, anything else is likely corruption.
+	if (size > 1048576)
+		return (false);
+
+	data.resize((size_t)size);
+
+	return (size == 0 || fread(&data[0], 1, (size_t)size, file) == size);
+}
+
+// Retrieves the path and size (if present) from a pax extended header, made up of "<length> <key>=<value>\n" records.
+static void parsePaxHeader(const string& data, string& path, unsigned long long& size, bool& hasSize)
+{
+	string::size_type recordStart = 0;
+
+	while (recordStart < data.length())
+	{
+		string::size_type lengthEnd = data.find(' ', recordStart);
+
+		if (lengthEnd == string::npos)
+			return;
+
+		unsigned long long recordLength = strtoull(data.c_str() + recordStart, nullptr, 10);
+
+		if (recordLength == 0 || recordStart + recordLength > data.length())
+			return;
+
+		string record = data.substr(lengthEnd + 1, (size_t)(recordStart + recordLength - lengthEnd - 2));
+		string::size_type equals = record.find('=');
+
+		if (equals != string::npos)
+		{
+			string key = record.substr(0, equals);
+
+			if (key == "path")
+			{
+				path = record.substr(equals + 1);
+			}
+			else if (key == "size")
+			{
+				size = strtoull(record.c_str() + equals + 1, nullptr, 10);
+				hasSize = true;
+			}
+		}
+
+		recordStart += (string::size_type)recordLength;
+	}
+}
+
+bool TarArchive::ReadMembers(FILE *file, vector<TarMember>& members)
+{
+	unsigned char header[kTarBlockSize];
+	unsigned long long headerOffset = 0;
+
+	// Long names and sizes from GNU and pax extended headers apply to the following member.
+	string extendedPath;
+	unsigned long long extendedSize = 0;
+	bool hasExtendedSize = false;
+
+	members.clear();
+
+	FileSeek(file, 0, SEEK_END);
+	unsigned long long archiveSize = (unsigned long long)FileTell(file);
+
+	while (true)
+	{
+		FileSeek(file, headerOffset, SEEK_SET);
+
+		// An archive that's been cut short of its end-of-archive blocks is still usable.
+		bool headerRead = fread(header, 1, kTarBlockSize, file) == kTarBlockSize;
+
+		if (headerRead && isBlockEmpty(header))
+			break;
+
+		if (!headerRead || !isHeaderValid(header))
+		{
+			if (headerOffset == 0)
+			{
+				Interface::PrintError("File is not a tar archive!\n");
+				FileRewind(file);
+				return (false);
+			}
+
+			break;
+		}
+
+		unsigned long long size = readHeaderNumber(header, kTarHeaderSizeOffset, kTarHeaderSizeLength);
+		char type = (char)header[kTarHeaderTypeOffset];
+
+		// A pax size describes the member, not an extended header that precedes it.
+		if (hasExtendedSize && type != 'L' && type != 'x')
+			size = extendedSize;
+
+		unsigned long long dataOffset = headerOffset + kTarBlockSize;
+		headerOffset = dataOffset + (size + kTarBlockSize - 1) / kTarBlockSize * kTarBlockSize;
+
+		if (type == 'L' || type == 'x')
+		{
+			string data;
+
+			if (!readExtendedData(file, size, data))
+			{
+				Interface::PrintError("Failed to read tar extended header!\n");
+				FileRewind(file);
+				return (false);
+			}
+
+			if (type == 'L')
+				extendedPath = data.c_str();
+			else
+				parsePaxHeader(data, extendedPath, extendedSize, hasExtendedSize);
+
+			continue;
+		}
+
+		if (type == '0' || type == '\0' || type == '7')
+		{
+			if (dataOffset + size > archiveSize)
+			{
+				Interface::PrintError("Tar archive is truncated!\n");
+				FileRewind(file);
+				return (false);
+			}
+
+			TarMember member;
+
+			if (!extendedPath.empty())
+			{
+				member.name = extendedPath;
+			}
+			else
+			{
+				member.name = readHeaderString(header, kTarHeaderNameOffset, kTarHeaderNameLength);
+
+				// ustar splits long names between the name and prefix fields. GNU headers ("ustar  ") use the prefix
+				// field for other things, so only a NUL-terminated POSIX magic counts.
+				string prefix;
+
+				if (memcmp(header + kTarHeaderMagicOffset, "ustar\0", 6) == 0)
+					prefix = readHeaderString(header, kTarHeaderPrefixOffset, kTarHeaderPrefixLength);
+
+				if (!prefix.empty())
+					member.name = prefix + "/" + member.name;
+			}
+
+			member.offset = dataOffset;
+			member.size = size;
+
+			members.push_back(member);
+		}
+
+		extendedPath.clear();
+		hasExtendedSize = false;
+	}
+
+	FileRewind(file);
+	return (true);
+}
@@ -0,0 +1,49 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef TARARCHIVE_H
+#define TARARCHIVE_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace Heimdall
+{
+	struct TarMember
+	{
+		std::string name;
+
+		// The member's data is stored uncompressed at this offset within the archive.
+		unsigned long long offset;
+		unsigned long long size;
+	};
+
+	namespace TarArchive
+	{
+		// Indexes the regular files in a tar archive (e.g. Samsung's AP/BL/CP/CSC .tar.md5 firmware), reading only their
+		// headers. Anything following the end of the archive, such as the MD5 checksum appended to .tar.md5 files, is
+		// ignored.
+		bool ReadMembers(FILE *file, std::vector<TarMember>& members);
+	}
+}
+
+#endif
@@ -28,18 +28,24 @@ namespace Heimdall
 {
 	class TotalBytesPacket : public SessionSetupPacket
 	{
+		protected:
+
+			typedef libpit::PackedLayout<SessionSetupPacket::kDataSize, unsigned long long> Layout;
+
+			static_assert(Layout::kEnd <= ControlPacket::kSize, "Packet fields exceed the packet size");
+
 		private:
 
-			unsigned int totalBytes;
+			unsigned long long totalBytes;
 
 		public:
 
-			TotalBytesPacket(unsigned int totalBytes) : SessionSetupPacket(SessionSetupPacket::kTotalBytes)
+			TotalBytesPacket(unsigned long long totalBytes) : SessionSetupPacket(SessionSetupPacket::kTotalBytes)
 			{
 				this->totalBytes = totalBytes;
 			}
 
-			unsigned int GetTotalBytes(void) const
+			unsigned long long GetTotalBytes(void) const
 			{
 				return (totalBytes);
 			}
@@ -48,7 +54,8 @@ namespace Heimdall
 			{
 				SessionSetupPacket::Pack();
 
-				PackInteger(SessionSetupPacket::kDataSize, totalBytes);
+				// The total is a 64-bit value, bootloaders that only support 32-bit totals just read the low half.
+				Layout::Pack(data, totalBytes);
 			}
 	};
 }
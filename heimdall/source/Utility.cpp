@@ -19,16 +19,37 @@
  THE SOFTWARE.*/
 
 // C/C++ Standard Library
+#include <cctype>
 #include <cerrno>
+#include <chrono>
 #include <limits.h>
 #include <stdlib.h>
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
 // Heimdall
 #include "Heimdall.h"
 #include "Utility.h"
 
+using namespace std;
 using namespace Heimdall;
 
+static bool createDirectory(const string& path)
+{
+#ifdef _WIN32
+	int result = _mkdir(path.c_str());
+#else
+	int result = mkdir(path.c_str(), 0755);
+#endif
+
+	return (result == 0 || errno == EEXIST);
+}
+
 NumberParsingStatus Utility::ParseInt(int &intValue, const char *string, int base)
 {
     errno = 0;
@@ -80,3 +101,145 @@ NumberParsingStatus Utility::ParseUnsignedInt(unsigned int &uintValue, const cha
 	uintValue = ulongValue;
 	return (kNumberParsingStatusSuccess);
 }
+
+bool Utility::EqualsIgnoringCase(const string& a, const string& b)
+{
+	if (a.length() != b.length())
+		return (false);
+
+	for (string::size_type i = 0; i < a.length(); i++)
+	{
+		if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+			return (false);
+	}
+
+	return (true);
+}
+
+bool Utility::GetCacheDirectory(string& path, const char *subdirectory)
+{
+#ifdef _WIN32
+	const char *localAppData = getenv("LOCALAPPDATA");
+
+	if (!localAppData)
+		return (false);
+
+	path = localAppData;
+	path += "\\Heimdall";
+#else
+	const char *home = getenv("HOME");
+	const char *xdgCacheHome = getenv("XDG_CACHE_HOME");
+
+#ifdef __APPLE__
+	xdgCacheHome = nullptr;
+#endif
+
+	if (xdgCacheHome && *xdgCacheHome == '/')
+	{
+		path = xdgCacheHome;
+	}
+	else if (home)
+	{
+		path = home;
+
+#ifdef __APPLE__
+		path += "/Library/Caches";
+#else
+		path += "/.cache";
+#endif
+	}
+	else
+	{
+		return (false);
+	}
+
+	if (!createDirectory(path))
+		return (false);
+
+	path += "/heimdall";
+#endif
+
+	if (!createDirectory(path))
+		return (false);
+
+	if (subdirectory)
+	{
+#ifdef _WIN32
+		path += "\\";
+#else
+		path += "/";
+#endif
+		path += subdirectory;
+
+		if (!createDirectory(path))
+			return (false);
+	}
+
+	return (true);
+}
+
+bool Utility::GetCacheFilePath(string& path, const char *subdirectory, const string& name, const char *extension)
+{
+	if (!GetCacheDirectory(path, subdirectory))
+		return (false);
+
+	string filename = name;
+
+	for (size_t i = 0; i < filename.length(); i++)
+	{
+		char c = filename[i];
+
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.'))
+			filename[i] = '_';
+	}
+
+#ifdef _WIN32
+	path += "\\";
+#else
+	path += "/";
+#endif
+	path += filename;
+	path += extension;
+
+	return (true);
+}
+
+bool Utility::WriteFileAtomically(const string& path, const char *mode, const function<bool (FILE *file)>& write)
+{
+	string temporaryPath = path + ".tmp";
+	FILE *file = fopen(temporaryPath.c_str(), mode);
+
+	if (!file)
+		return (false);
+
+	bool success = write(file);
+
+	if (fclose(file) != 0)
+		success = false;
+
+	if (success)
+	{
+#ifdef _WIN32
+		// rename() won't replace an existing file on Windows.
+		remove(path.c_str());
+#endif
+		success = rename(temporaryPath.c_str(), path.c_str()) == 0;
+	}
+
+	if (!success)
+		remove(temporaryPath.c_str());
+
+	return (success);
+}
+
+unsigned long long Utility::GetMilliseconds(void)
+{
+	return (chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static const unsigned long long startMilliseconds = Utility::GetMilliseconds();
+
+unsigned long long Utility::GetStartMilliseconds(void)
+{
+	return (startMilliseconds);
+}
@@ -21,6 +21,11 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+// C/C++ Standard Library
+#include <functional>
+#include <stdio.h>
+#include <string>
+
 namespace Heimdall
 {
 	typedef enum
@@ -34,6 +39,27 @@ namespace Heimdall
 	{
 		NumberParsingStatus ParseInt(int &intValue, const char *string, int base = 0);
 		NumberParsingStatus ParseUnsignedInt(unsigned int &uintValue, const char *string, int base = 0);
+
+		// Compares (ASCII) strings, ignoring case.
+		bool EqualsIgnoringCase(const std::string& a, const std::string& b);
+
+		// Retrieves (creating if necessary) the directory in which Heimdall caches data between runs, or one of its
+		// subdirectories.
+		bool GetCacheDirectory(std::string& path, const char *subdirectory = nullptr);
+
+		// Retrieves the path of a file in a cache subdirectory. The name may come from a USB descriptor, so any
+		// characters that aren't safe in file names are replaced.
+		bool GetCacheFilePath(std::string& path, const char *subdirectory, const std::string& name, const char *extension);
+
+		// Replaces the file at path with whatever write() writes (returning false on failure). The data is written to a
+		// temporary file that's renamed over the original, so an interrupted write can't leave a truncated file behind.
+		bool WriteFileAtomically(const std::string& path, const char *mode, const std::function<bool (FILE *file)>& write);
+
+		// Monotonic time in milliseconds, for measuring intervals.
+		unsigned long long GetMilliseconds(void);
+
+		// The value of GetMilliseconds() when Heimdall was started.
+		unsigned long long GetStartMilliseconds(void);
 	}
 }
 
@@ -0,0 +1,280 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cstring>
+
+// libpit
+#include "PackedLayout.h"
+
+// Heimdall
+#include "XxHash.h"
+
+using namespace Heimdall;
+
+static const unsigned int kPrime32_1 = 2654435761U;
+static const unsigned int kPrime32_2 = 2246822519U;
+static const unsigned int kPrime32_3 = 3266489917U;
+static const unsigned int kPrime32_4 = 668265263U;
+static const unsigned int kPrime32_5 = 374761393U;
+
+static const unsigned long long kPrime64_1 = 11400714785074694791ULL;
+static const unsigned long long kPrime64_2 = 14029467366897019727ULL;
+static const unsigned long long kPrime64_3 = 1609587929392839161ULL;
+static const unsigned long long kPrime64_4 = 9650029242287828579ULL;
+static const unsigned long long kPrime64_5 = 2870177450012600261ULL;
+
+static inline unsigned int rotateLeft32(unsigned int value, unsigned int count)
+{
+	return ((value << count) | (value >> (32 - count)));
+}
+
+static inline unsigned int readLittleEndian32(const unsigned char *data)
+{
+	return (libpit::PackedField<unsigned int>::Load(data));
+}
+
+static inline unsigned int round32(unsigned int accumulator, unsigned int input)
+{
+	return (rotateLeft32(accumulator + input * kPrime32_2, 13) * kPrime32_1);
+}
+
+static inline unsigned long long rotateLeft64(unsigned long long value, unsigned int count)
+{
+	return ((value << count) | (value >> (64 - count)));
+}
+
+static inline unsigned long long readLittleEndian64(const unsigned char *data)
+{
+	return (libpit::PackedField<unsigned long long>::Load(data));
+}
+
+static inline unsigned long long round64(unsigned long long accumulator, unsigned long long input)
+{
+	return (rotateLeft64(accumulator + input * kPrime64_2, 31) * kPrime64_1);
+}
+
+static inline unsigned long long mergeRound64(unsigned long long hash, unsigned long long accumulator)
+{
+	return ((hash ^ round64(0, accumulator)) * kPrime64_1 + kPrime64_4);
+}
+
+Xxh32::Xxh32(unsigned int seed)
+{
+	this->seed = seed;
+
+	accumulators[0] = seed + kPrime32_1 + kPrime32_2;
+	accumulators[1] = seed + kPrime32_2;
+	accumulators[2] = seed;
+	accumulators[3] = seed - kPrime32_1;
+
+	length = 0;
+	stripeLength = 0;
+}
+
+void Xxh32::Update(const unsigned char *data, unsigned int length)
+{
+	this->length += length;
+
+	if (stripeLength > 0)
+	{
+		unsigned int count = (length < 16 - stripeLength) ? length : 16 - stripeLength;
+		memcpy(stripe + stripeLength, data, count);
+
+		stripeLength += count;
+		data += count;
+		length -= count;
+
+		if (stripeLength < 16)
+			return;
+
+		for (unsigned int i = 0; i < 4; i++)
+			accumulators[i] = round32(accumulators[i], readLittleEndian32(stripe + i * 4));
+
+		stripeLength = 0;
+	}
+
+	unsigned int v1 = accumulators[0];
+	unsigned int v2 = accumulators[1];
+	unsigned int v3 = accumulators[2];
+	unsigned int v4 = accumulators[3];
+
+	while (length >= 16)
+	{
+		v1 = round32(v1, readLittleEndian32(data));
+		v2 = round32(v2, readLittleEndian32(data + 4));
+		v3 = round32(v3, readLittleEndian32(data + 8));
+		v4 = round32(v4, readLittleEndian32(data + 12));
+
+		data += 16;
+		length -= 16;
+	}
+
+	accumulators[0] = v1;
+	accumulators[1] = v2;
+	accumulators[2] = v3;
+	accumulators[3] = v4;
+
+	memcpy(stripe, data, length);
+	stripeLength = length;
+}
+
+unsigned int Xxh32::GetDigest(void) const
+{
+	unsigned int hash;
+
+	if (length >= 16)
+	{
+		hash = rotateLeft32(accumulators[0], 1) + rotateLeft32(accumulators[1], 7) + rotateLeft32(accumulators[2], 12)
+			+ rotateLeft32(accumulators[3], 18);
+	}
+	else
+	{
+		hash = seed + kPrime32_5;
+	}
+
+	hash += (unsigned int)length;
+
+	unsigned int i = 0;
+
+	for (; i + 4 <= stripeLength; i += 4)
+		hash = rotateLeft32(hash + readLittleEndian32(stripe + i) * kPrime32_3, 17) * kPrime32_4;
+
+	for (; i < stripeLength; i++)
+		hash = rotateLeft32(hash + stripe[i] * kPrime32_5, 11) * kPrime32_1;
+
+	hash ^= hash >> 15;
+	hash *= kPrime32_2;
+	hash ^= hash >> 13;
+	hash *= kPrime32_3;
+	hash ^= hash >> 16;
+
+	return (hash);
+}
+
+unsigned int Xxh32::Hash(const unsigned char *data, unsigned int length, unsigned int seed)
+{
+	Xxh32 xxh32(seed);
+	xxh32.Update(data, length);
+
+	return (xxh32.GetDigest());
+}
+
+Xxh64::Xxh64(unsigned long long seed)
+{
+	this->seed = seed;
+
+	accumulators[0] = seed + kPrime64_1 + kPrime64_2;
+	accumulators[1] = seed + kPrime64_2;
+	accumulators[2] = seed;
+	accumulators[3] = seed - kPrime64_1;
+
+	length = 0;
+	stripeLength = 0;
+}
+
+void Xxh64::Update(const unsigned char *data, unsigned int length)
+{
+	this->length += length;
+
+	if (stripeLength > 0)
+	{
+		unsigned int count = (length < 32 - stripeLength) ? length : 32 - stripeLength;
+		memcpy(stripe + stripeLength, data, count);
+
+		stripeLength += count;
+		data += count;
+		length -= count;
+
+		if (stripeLength < 32)
+			return;
+
+		for (unsigned int i = 0; i < 4; i++)
+			accumulators[i] = round64(accumulators[i], readLittleEndian64(stripe + i * 8));
+
+		stripeLength = 0;
+	}
+
+	unsigned long long v1 = accumulators[0];
+	unsigned long long v2 = accumulators[1];
+	unsigned long long v3 = accumulators[2];
+	unsigned long long v4 = accumulators[3];
+
+	while (length >= 32)
+	{
+		v1 = round64(v1, readLittleEndian64(data));
+		v2 = round64(v2, readLittleEndian64(data + 8));
+		v3 = round64(v3, readLittleEndian64(data + 16));
+		v4 = round64(v4, readLittleEndian64(data + 24));
+
+		data += 32;
+		length -= 32;
+	}
+
+	accumulators[0] = v1;
+	accumulators[1] = v2;
+	accumulators[2] = v3;
+	accumulators[3] = v4;
+
+	memcpy(stripe, data, length);
+	stripeLength = length;
+}
+
+unsigned long long Xxh64::GetDigest(void) const
+{
+	unsigned long long hash;
+
+	if (length >= 32)
+	{
+		hash = rotateLeft64(accumulators[0], 1) + rotateLeft64(accumulators[1], 7) + rotateLeft64(accumulators[2], 12)
+			+ rotateLeft64(accumulators[3], 18);
+
+		for (unsigned int i = 0; i < 4; i++)
+			hash = mergeRound64(hash, accumulators[i]);
+	}
+	else
+	{
+		hash = seed + kPrime64_5;
+	}
+
+	hash += length;
+
+	unsigned int i = 0;
+
+	for (; i + 8 <= stripeLength; i += 8)
+		hash = rotateLeft64(hash ^ round64(0, readLittleEndian64(stripe + i)), 27) * kPrime64_1 + kPrime64_4;
+
+	if (i + 4 <= stripeLength)
+	{
+		hash = rotateLeft64(hash ^ (readLittleEndian32(stripe + i) * kPrime64_1), 23) * kPrime64_2 + kPrime64_3;
+		i += 4;
+	}
+
+	for (; i < stripeLength; i++)
+		hash = rotateLeft64(hash ^ (stripe[i] * kPrime64_5), 11) * kPrime64_1;
+
+	hash ^= hash >> 33;
+	hash *= kPrime64_2;
+	hash ^= hash >> 29;
+	hash *= kPrime64_3;
+	hash ^= hash >> 32;
+
+	return (hash);
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef XXHASH_H
+#define XXHASH_H
+
+namespace Heimdall
+{
+	// Incremental XXH32, as used for the checksums in LZ4 frames.
+	class Xxh32
+	{
+		private:
+
+			unsigned int seed;
+			unsigned int accumulators[4];
+			unsigned long long length;
+
+			unsigned char stripe[16];
+			unsigned int stripeLength;
+
+		public:
+
+			Xxh32(unsigned int seed = 0);
+
+			void Update(const unsigned char *data, unsigned int length);
+			unsigned int GetDigest(void) const;
+
+			static unsigned int Hash(const unsigned char *data, unsigned int length, unsigned int seed = 0);
+	};
+
+	// Incremental XXH64, for hashing whole files quickly.
+	class Xxh64
+	{
+		private:
+
+			unsigned long long seed;
+			unsigned long long accumulators[4];
+			unsigned long long length;
+
+			unsigned char stripe[32];
+			unsigned int stripeLength;
+
+		public:
+
+			Xxh64(unsigned long long seed = 0);
+
+			void Update(const unsigned char *data, unsigned int length);
+			unsigned long long GetDigest(void) const;
+	};
+}
+
+#endif
@@ -0,0 +1,180 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <string.h>
+
+// Heimdall
+#include "FilePartReader.h"
+#include "FileTransferPlan.h"
+#include "Heimdall.h"
+#include "MappedFilePartSource.h"
+#include "SequenceLengthTuner.h"
+#include "Tests.h"
+
+using namespace Heimdall;
+
+static const unsigned char kMarker[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+
+// 5 GiB and 4 bytes, so the final 1 MiB part holds just the last marker.
+static const unsigned long long kLargeFileSize = 5 * kGibibyte + 4;
+
+// The data before the last 4 bytes is filled, so that a final part reusing an earlier part's buffer isn't padded with
+// zeros by chance.
+static const unsigned int kFilledLength = 32 * kMebibyte;
+
+// Creates a sparse temporary file, with markers at 4 GiB and in its last 4 bytes, preceded by kFilledLength bytes of
+// 0xFF. Everything else reads as zeros.
+static FILE *createSparseFile(unsigned long long fileSize)
+{
+	FILE *file = tmpfile();
+
+	if (!file)
+		return (nullptr);
+
+	unsigned char *filled = new unsigned char[kFilledLength];
+	memset(filled, 0xFF, kFilledLength);
+
+	bool success = FileSeek(file, 4 * kGibibyte, SEEK_SET) == 0 && fwrite(kMarker, 1, 4, file) == 4
+		&& FileSeek(file, fileSize - 4 - kFilledLength, SEEK_SET) == 0 && fwrite(filled, 1, kFilledLength, file) == kFilledLength
+		&& fwrite(kMarker, 1, 4, file) == 4 && fflush(file) == 0;
+
+	delete [] filled;
+
+	if (!success)
+	{
+		fclose(file);
+		return (nullptr);
+	}
+
+	FileRewind(file);
+	return (file);
+}
+
+static bool isZero(const unsigned char *data, unsigned int length)
+{
+	for (unsigned int i = 0; i < length; i++)
+	{
+		if (data[i] != 0)
+			return (false);
+	}
+
+	return (true);
+}
+
+// Consumes the source the way BridgeManager::SendFile() does. Sequence lengths come from an autotuning tuner, so they
+// change between sequences, and the effective size of each sequence comes from the plan.
+static void streamSource(FilePartSource *source, unsigned int partSize, unsigned int sequenceMaxLength)
+{
+	unsigned long long fileSize = source->GetSize();
+
+	FileTransferPlan transferPlan(fileSize, partSize, sequenceMaxLength);
+	SequenceLengthTuner sequenceLengthTuner = SequenceLengthTuner::CreateAutotuning(sequenceMaxLength);
+
+	unsigned int partCount = transferPlan.GetPartCount();
+	unsigned int markerPartIndex = (unsigned int)(4 * kGibibyte / partSize);
+	unsigned int lastPartLength = (unsigned int)(fileSize - (unsigned long long)(partCount - 1) * partSize);
+
+	CHECK_EQUAL(source->Start(partSize), true);
+
+	unsigned long long bytesSent = 0;
+	unsigned int partsSent = 0;
+	unsigned int firstPartIndex = 0;
+
+	while (firstPartIndex < partCount)
+	{
+		unsigned int sequenceLength = sequenceLengthTuner.GetSequenceLength();
+		unsigned int sequenceSize = (partCount - firstPartIndex < sequenceLength) ? partCount - firstPartIndex : sequenceLength;
+
+		for (unsigned int i = 0; i < sequenceSize; i++)
+		{
+			unsigned int partIndex = firstPartIndex + i;
+			unsigned char *partData = source->AcquirePart();
+
+			if (!partData)
+			{
+				CHECK_EQUAL(partData != nullptr, true);
+				return;
+			}
+
+			if (partIndex == markerPartIndex)
+				CHECK_EQUAL(memcmp(partData, kMarker, 4), 0);
+
+			// The final part is padded with zeros.
+			if (partIndex == partCount - 1)
+			{
+				CHECK_EQUAL(lastPartLength, 4);
+				CHECK_EQUAL(memcmp(partData, kMarker, 4), 0);
+				CHECK_EQUAL(isZero(partData + lastPartLength, partSize - lastPartLength), true);
+			}
+
+			source->ReleasePart();
+			partsSent++;
+		}
+
+		unsigned int sequenceEffectiveByteCount = (unsigned int)transferPlan.GetByteCount(firstPartIndex, sequenceSize);
+
+		if (sequenceSize == sequenceLength)
+			sequenceLengthTuner.RecordSequence(sequenceLength, sequenceEffectiveByteCount, 1);
+
+		bytesSent += sequenceEffectiveByteCount;
+		firstPartIndex += sequenceSize;
+	}
+
+	CHECK_EQUAL(partsSent, 5121);
+	CHECK_EQUAL(bytesSent, fileSize);
+	CHECK_EQUAL(sequenceLengthTuner.IsTuned(), true);
+}
+
+static void testFilePartReader(FILE *file)
+{
+	FilePartReader reader(file);
+
+	CHECK_EQUAL(reader.GetSize(), kLargeFileSize);
+	streamSource(&reader, kMebibyte, 30);
+}
+
+static void testMappedFilePartSource(FILE *file)
+{
+	CHECK_EQUAL(MappedFilePartSource::IsMappable(file), true);
+
+	MappedFilePartSource source(file);
+
+	CHECK_EQUAL(source.GetSize(), kLargeFileSize);
+	streamSource(&source, kMebibyte, 30);
+}
+
+void runFilePartSourceTests(void)
+{
+	FILE *file = createSparseFile(kLargeFileSize);
+
+	if (!file)
+	{
+		CHECK_EQUAL(file != nullptr, true);
+		return;
+	}
+
+	testFilePartReader(file);
+	FileRewind(file);
+
+	testMappedFilePartSource(file);
+	fclose(file);
+}
@@ -0,0 +1,129 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Heimdall
+#include "FileTransferPlan.h"
+#include "Tests.h"
+
+using namespace Heimdall;
+
+// Walks the plan a sequence at a time, as the dry run's counts assume, checking that the size of each sequence agrees
+// with GetByteCount(). Returns the number of bytes accounted for.
+static unsigned long long streamPlan(const FileTransferPlan& plan, unsigned int *sequencesSent)
+{
+	unsigned long long bytesSent = 0;
+	unsigned int firstPartIndex = 0;
+
+	*sequencesSent = 0;
+
+	for (unsigned int sequenceIndex = 0; sequenceIndex < plan.GetSequenceCount(); sequenceIndex++)
+	{
+		unsigned int sequenceLength = plan.GetSequenceLength(sequenceIndex);
+
+		CHECK_EQUAL(plan.GetByteCount(firstPartIndex, sequenceLength), plan.GetSequenceByteCount(sequenceIndex));
+
+		bytesSent += plan.GetSequenceByteCount(sequenceIndex);
+		firstPartIndex += sequenceLength;
+		(*sequencesSent)++;
+	}
+
+	CHECK_EQUAL(firstPartIndex, plan.GetPartCount());
+
+	return (bytesSent);
+}
+
+static void testLargeFile(void)
+{
+	// 5 GiB and 4 bytes, in 1 MiB parts with up to 30 per sequence. The final part only holds 4 bytes.
+	unsigned long long fileSize = 5 * kGibibyte + 4;
+	FileTransferPlan plan(fileSize, kMebibyte, 30);
+
+	CHECK_EQUAL(plan.GetFileSize(), fileSize);
+	CHECK_EQUAL(plan.GetPartCount(), 5121);
+	CHECK_EQUAL(plan.GetSequenceCount(), 171);
+	CHECK_EQUAL(plan.GetSequenceLength(0), 30);
+	CHECK_EQUAL(plan.GetSequenceLength(170), 21);
+	CHECK_EQUAL(plan.GetSequenceByteCount(0), 30 * kMebibyte);
+	CHECK_EQUAL(plan.GetSequenceByteCount(170), 20 * kMebibyte + 4);
+	CHECK_EQUAL(plan.GetByteCount(5120, 1), 4);
+
+	unsigned int sequencesSent;
+
+	CHECK_EQUAL(streamPlan(plan, &sequencesSent), fileSize);
+	CHECK_EQUAL(sequencesSent, 171);
+}
+
+static void testExactMultipleOfPartSize(void)
+{
+	// Exactly 5 GiB, so there's no partial part at the end.
+	unsigned long long fileSize = 5 * kGibibyte;
+	FileTransferPlan plan(fileSize, kMebibyte, 30);
+
+	CHECK_EQUAL(plan.GetPartCount(), 5120);
+	CHECK_EQUAL(plan.GetSequenceCount(), 171);
+	CHECK_EQUAL(plan.GetSequenceLength(170), 20);
+	CHECK_EQUAL(plan.GetSequenceByteCount(170), 20 * kMebibyte);
+	CHECK_EQUAL(plan.GetByteCount(5119, 1), kMebibyte);
+
+	unsigned int sequencesSent;
+
+	CHECK_EQUAL(streamPlan(plan, &sequencesSent), fileSize);
+}
+
+static void testFourGibibyteBoundary(void)
+{
+	// The default part size and sequence length, as used by devices that don't support changing the part size.
+	const unsigned int partSize = 131072;
+	const unsigned int sequenceMaxLength = 800;
+
+	FileTransferPlan exactPlan(4 * kGibibyte, partSize, sequenceMaxLength);
+
+	CHECK_EQUAL(exactPlan.GetPartCount(), 32768);
+	CHECK_EQUAL(exactPlan.GetSequenceCount(), 41);
+	CHECK_EQUAL(exactPlan.GetSequenceLength(40), 768);
+	CHECK_EQUAL(exactPlan.GetSequenceByteCount(40), 768 * partSize);
+
+	FileTransferPlan overPlan(4 * kGibibyte + 1, partSize, sequenceMaxLength);
+
+	CHECK_EQUAL(overPlan.GetPartCount(), 32769);
+	CHECK_EQUAL(overPlan.GetSequenceCount(), 41);
+	CHECK_EQUAL(overPlan.GetSequenceLength(40), 769);
+	CHECK_EQUAL(overPlan.GetSequenceByteCount(40), 768 * partSize + 1);
+
+	unsigned int sequencesSent;
+
+	CHECK_EQUAL(streamPlan(overPlan, &sequencesSent), 4 * kGibibyte + 1);
+}
+
+static void testEmptyFile(void)
+{
+	FileTransferPlan plan(0, kMebibyte, 30);
+
+	CHECK_EQUAL(plan.GetPartCount(), 0);
+	CHECK_EQUAL(plan.GetSequenceCount(), 0);
+}
+
+void runFileTransferPlanTests(void)
+{
+	testLargeFile();
+	testExactMultipleOfPartSize();
+	testFourGibibyteBoundary();
+	testEmptyFile();
+}
@@ -0,0 +1,141 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "EndPhoneFileTransferPacket.h"
+#include "FilePartReader.h"
+#include "FileTransferPlan.h"
+#include "FlashPartFileTransferPacket.h"
+#include "Heimdall.h"
+#include "PacketBufferPool.h"
+#include "ResponsePacket.h"
+#include "SendFilePartPacket.h"
+#include "SendFilePartResponse.h"
+#include "Tests.h"
+
+using namespace Heimdall;
+
+static const unsigned long long kStreamedFileSize = 2 * kGibibyte;
+
+// Not used by the other tests, so the pool starts with no free buffers of this size.
+static const unsigned int kPartSize = 512 * 1024;
+
+// Streams the file through a FilePartReader, creating the packets that BridgeManager::SendFile() creates for each part
+// and sequence. Returns the number of buffers allocated after the first sequence, through to the end of the file.
+static unsigned int streamFile(FILE *file, unsigned int partSize, unsigned int sequenceMaxLength)
+{
+	FilePartReader reader(file);
+
+	if (!reader.Start(partSize))
+	{
+		CHECK_EQUAL(false, true);
+		return (0);
+	}
+
+	FileTransferPlan transferPlan(reader.GetSize(), partSize, sequenceMaxLength);
+	unsigned int partCount = transferPlan.GetPartCount();
+	unsigned int firstPartIndex = 0;
+
+	unsigned int steadyAllocationCount = 0;
+
+	while (firstPartIndex < partCount)
+	{
+		unsigned int sequenceSize = (partCount - firstPartIndex < sequenceMaxLength) ? partCount - firstPartIndex
+			: sequenceMaxLength;
+
+		FlashPartFileTransferPacket beginFileTransferPacket(sequenceSize * partSize);
+		beginFileTransferPacket.Pack();
+
+		ResponsePacket beginFileTransferResponse(ResponsePacket::kResponseTypeFileTransfer);
+
+		for (unsigned int i = 0; i < sequenceSize; i++)
+		{
+			unsigned char *partData = reader.AcquirePart();
+
+			if (!partData)
+			{
+				CHECK_EQUAL(partData != nullptr, true);
+				return (0);
+			}
+
+			SendFilePartPacket sendFilePartPacket(partData, partSize);
+			sendFilePartPacket.Pack();
+
+			SendFilePartResponse sendFilePartResponse;
+
+			reader.ReleasePart();
+		}
+
+		unsigned int sequenceEffectiveByteCount = (unsigned int)transferPlan.GetByteCount(firstPartIndex, sequenceSize);
+
+		EndPhoneFileTransferPacket endPhoneFileTransferPacket(sequenceEffectiveByteCount, 0, 0, 0,
+			firstPartIndex + sequenceSize == partCount);
+		endPhoneFileTransferPacket.Pack();
+
+		if (firstPartIndex == 0)
+			steadyAllocationCount = PacketBufferPool::GetAllocationCount();
+
+		firstPartIndex += sequenceSize;
+	}
+
+	return (PacketBufferPool::GetAllocationCount() - steadyAllocationCount);
+}
+
+static void testSteadyStateAllocations(FILE *file)
+{
+	unsigned int allocationCount = PacketBufferPool::GetAllocationCount();
+
+	CHECK_EQUAL(streamFile(file, kPartSize, 30), 0);
+
+	unsigned int firstFileAllocationCount = PacketBufferPool::GetAllocationCount() - allocationCount;
+
+	printf("PacketBufferPool: %u allocations streaming %llu GiB in %u KiB parts.\n", firstFileAllocationCount,
+		kStreamedFileSize / kGibibyte, kPartSize / 1024);
+
+	// A second file sent with the same part size reuses the first's buffers.
+	FileRewind(file);
+	allocationCount = PacketBufferPool::GetAllocationCount();
+
+	CHECK_EQUAL(streamFile(file, kPartSize, 30), 0);
+	CHECK_EQUAL(PacketBufferPool::GetAllocationCount() - allocationCount, 0);
+}
+
+void runPacketBufferPoolTests(void)
+{
+	// Sparse, so only the last byte is written.
+	FILE *file = tmpfile();
+
+	if (!file || FileSeek(file, kStreamedFileSize - 1, SEEK_SET) != 0 || fputc(0, file) == EOF || fflush(file) != 0)
+	{
+		CHECK_EQUAL(false, true);
+
+		if (file)
+			fclose(file);
+
+		return;
+	}
+
+	FileRewind(file);
+	testSteadyStateAllocations(file);
+	fclose(file);
+}
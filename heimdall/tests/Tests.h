@@ -0,0 +1,37 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef TESTS_H
+#define TESTS_H
+
+static const unsigned long long kGibibyte = 1073741824ULL;
+static const unsigned int kMebibyte = 1048576;
+
+// Records a failure (and carries on) if actual differs from expected.
+#define CHECK_EQUAL(actual, expected) checkEqual(__FILE__, __LINE__, #actual, (unsigned long long)(actual), \
+	(unsigned long long)(expected))
+
+void checkEqual(const char *file, int line, const char *description, unsigned long long actual, unsigned long long expected);
+
+void runFilePartSourceTests(void);
+void runFileTransferPlanTests(void);
+void runPacketBufferPoolTests(void);
+
+#endif
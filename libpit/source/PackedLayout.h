@@ -0,0 +1,132 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef PACKEDLAYOUT_H
+#define PACKEDLAYOUT_H
+
+namespace libpit
+{
+	// Little-endian encoding of a single field. Values are assembled with shifts, so the result is independent of
+	// host byte order and requires no branching.
+	template <typename FieldType>
+	struct PackedField;
+
+	template <>
+	struct PackedField<unsigned short>
+	{
+		static constexpr unsigned int kSize = 2;
+
+		static void Store(unsigned char *data, unsigned short value)
+		{
+			data[0] = (unsigned char)value;
+			data[1] = (unsigned char)(value >> 8);
+		}
+
+		static unsigned short Load(const unsigned char *data)
+		{
+			return ((unsigned short)(data[0] | (data[1] << 8)));
+		}
+	};
+
+	template <>
+	struct PackedField<unsigned int>
+	{
+		static constexpr unsigned int kSize = 4;
+
+		static void Store(unsigned char *data, unsigned int value)
+		{
+			data[0] = (unsigned char)value;
+			data[1] = (unsigned char)(value >> 8);
+			data[2] = (unsigned char)(value >> 16);
+			data[3] = (unsigned char)(value >> 24);
+		}
+
+		static unsigned int Load(const unsigned char *data)
+		{
+			return ((unsigned int)data[0] | ((unsigned int)data[1] << 8) | ((unsigned int)data[2] << 16)
+				| ((unsigned int)data[3] << 24));
+		}
+	};
+
+	template <>
+	struct PackedField<unsigned long long>
+	{
+		static constexpr unsigned int kSize = 8;
+
+		static void Store(unsigned char *data, unsigned long long value)
+		{
+			PackedField<unsigned int>::Store(data, (unsigned int)value);
+			PackedField<unsigned int>::Store(data + 4, (unsigned int)(value >> 32));
+		}
+
+		static unsigned long long Load(const unsigned char *data)
+		{
+			return ((unsigned long long)PackedField<unsigned int>::Load(data)
+				| ((unsigned long long)PackedField<unsigned int>::Load(data + 4) << 32));
+		}
+	};
+
+	// A run of consecutive fields beginning at Offset. The offset of each field, and the end of the run, are known at
+	// compile time so layouts can be checked with static_assert and Pack()/Unpack() compile down to plain stores and
+	// loads. e.g.
+	//
+	//   typedef PackedLayout<8, unsigned int, unsigned short> Layout; // Fields at 8 and 12, Layout::kEnd == 14
+	//   Layout::Pack(data, identifier, flags);
+	template <unsigned int Offset, typename... FieldTypes>
+	struct PackedLayout;
+
+	template <unsigned int Offset>
+	struct PackedLayout<Offset>
+	{
+		static constexpr unsigned int kOffset = Offset;
+		static constexpr unsigned int kEnd = Offset;
+
+		static void Pack(unsigned char *)
+		{
+		}
+
+		static void Unpack(const unsigned char *)
+		{
+		}
+	};
+
+	template <unsigned int Offset, typename FieldType, typename... FieldTypes>
+	struct PackedLayout<Offset, FieldType, FieldTypes...>
+	{
+		typedef PackedLayout<Offset + PackedField<FieldType>::kSize, FieldTypes...> RemainingFields;
+
+		static constexpr unsigned int kOffset = Offset;
+		static constexpr unsigned int kEnd = RemainingFields::kEnd;
+
+		static void Pack(unsigned char *data, FieldType value, FieldTypes... values)
+		{
+			PackedField<FieldType>::Store(data + Offset, value);
+			RemainingFields::Pack(data, values...);
+		}
+
+		static void Unpack(const unsigned char *data, FieldType& value, FieldTypes&... values)
+		{
+			value = PackedField<FieldType>::Load(data + Offset);
+			RemainingFields::Unpack(data, values...);
+		}
+	};
+}
+
+#endif
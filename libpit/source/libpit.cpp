@@ -87,68 +87,45 @@ PitData::~PitData()
 
 bool PitData::Unpack(const unsigned char *data)
 {
-	if (PitData::UnpackInteger(data, 0) != PitData::kFileIdentifier)
+	if (PackedField<unsigned int>::Load(data) != PitData::kFileIdentifier)
 		return (false);
 
 	// Remove existing entries
 	for (unsigned int i = 0; i < entries.size(); i++)
 		delete entries[i];
 
-	entryCount = PitData::UnpackInteger(data, 4);
+	unsigned int fileIdentifier;
 
-	entries.resize(entryCount);
-
-	unknown1 = PitData::UnpackInteger(data, 8);
-	unknown2 = PitData::UnpackInteger(data, 12);
-
-	unknown3 = PitData::UnpackShort(data, 16);
-	unknown4 = PitData::UnpackShort(data, 18);
-
-	unknown5 = PitData::UnpackShort(data, 20);
-	unknown6 = PitData::UnpackShort(data, 22);
+	HeaderLayout::Unpack(data, fileIdentifier, entryCount, unknown1, unknown2, unknown3, unknown4, unknown5, unknown6,
+		unknown7, unknown8);
 
-	unknown7 = PitData::UnpackShort(data, 24);
-	unknown8 = PitData::UnpackShort(data, 26);
+	entries.resize(entryCount);
 
-	unsigned int integerValue;
-	unsigned int entryOffset;
+	unsigned int binaryType, deviceType, identifier, attributes, updateAttributes, blockSizeOrOffset, blockCount,
+		fileOffset, fileSize;
 
 	for (unsigned int i = 0; i < entryCount; i++)
 	{
-		entryOffset = PitData::kHeaderDataSize + i * PitEntry::kDataSize;
-
-		entries[i] = new PitEntry();
-
-		integerValue = PitData::UnpackInteger(data, entryOffset);
-		entries[i]->SetBinaryType(integerValue);
-
-		integerValue = PitData::UnpackInteger(data, entryOffset + 4);
-		entries[i]->SetDeviceType(integerValue);
-
-		integerValue = PitData::UnpackInteger(data, entryOffset + 8);
-		entries[i]->SetIdentifier(integerValue);
-
-		integerValue = PitData::UnpackInteger(data, entryOffset + 12);
-		entries[i]->SetAttributes(integerValue);
-
-		integerValue = PitData::UnpackInteger(data, entryOffset + 16);
-		entries[i]->SetUpdateAttributes(integerValue);
-
-		integerValue = PitData::UnpackInteger(data, entryOffset + 20);
-		entries[i]->SetBlockSizeOrOffset(integerValue);
+		const unsigned char *entryData = data + PitData::kHeaderDataSize + i * PitEntry::kDataSize;
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 24);
-		entries[i]->SetBlockCount(integerValue);
+		EntryLayout::Unpack(entryData, binaryType, deviceType, identifier, attributes, updateAttributes,
+			blockSizeOrOffset, blockCount, fileOffset, fileSize);
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 28);
-		entries[i]->SetFileOffset(integerValue);
-
-		integerValue = PitData::UnpackInteger(data, entryOffset + 32);
-		entries[i]->SetFileSize(integerValue);
+		entries[i] = new PitEntry();
 
-		entries[i]->SetPartitionName((const char *)data + entryOffset + 36);
-		entries[i]->SetFlashFilename((const char *)data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength);
-		entries[i]->SetFotaFilename((const char *)data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength);
+		entries[i]->SetBinaryType(binaryType);
+		entries[i]->SetDeviceType(deviceType);
+		entries[i]->SetIdentifier(identifier);
+		entries[i]->SetAttributes(attributes);
+		entries[i]->SetUpdateAttributes(updateAttributes);
+		entries[i]->SetBlockSizeOrOffset(blockSizeOrOffset);
+		entries[i]->SetBlockCount(blockCount);
+		entries[i]->SetFileOffset(fileOffset);
+		entries[i]->SetFileSize(fileSize);
+
+		entries[i]->SetPartitionName((const char *)entryData + EntryLayout::kEnd);
+		entries[i]->SetFlashFilename((const char *)entryData + EntryLayout::kEnd + PitEntry::kPartitionNameMaxLength);
+		entries[i]->SetFotaFilename((const char *)entryData + EntryLayout::kEnd + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength);
 	}
 
 	return (true);
@@ -156,45 +133,20 @@ bool PitData::Unpack(const unsigned char *data)
 
 void PitData::Pack(unsigned char *data) const
 {
-	PitData::PackInteger(data, 0, PitData::kFileIdentifier);
-
-	PitData::PackInteger(data, 4, entryCount);
-
-	PitData::PackInteger(data, 8, unknown1);
-	PitData::PackInteger(data, 12, unknown2);
-
-	PitData::PackShort(data, 16, unknown3);
-	PitData::PackShort(data, 18, unknown4);
-
-	PitData::PackShort(data, 20, unknown5);
-	PitData::PackShort(data, 22, unknown6);
-
-	PitData::PackShort(data, 24, unknown7);
-	PitData::PackShort(data, 26, unknown8);
-
-	int entryOffset;
+	HeaderLayout::Pack(data, PitData::kFileIdentifier, entryCount, unknown1, unknown2, unknown3, unknown4, unknown5,
+		unknown6, unknown7, unknown8);
 
 	for (unsigned int i = 0; i < entryCount; i++)
 	{
-		entryOffset = PitData::kHeaderDataSize + i * PitEntry::kDataSize;
-
-		PitData::PackInteger(data, entryOffset, entries[i]->GetBinaryType());
-
-		PitData::PackInteger(data, entryOffset + 4, entries[i]->GetDeviceType());
-		PitData::PackInteger(data, entryOffset + 8, entries[i]->GetIdentifier());
-		PitData::PackInteger(data, entryOffset + 12, entries[i]->GetAttributes());
-
-		PitData::PackInteger(data, entryOffset + 16, entries[i]->GetUpdateAttributes());
-
-		PitData::PackInteger(data, entryOffset + 20, entries[i]->GetBlockSizeOrOffset());
-		PitData::PackInteger(data, entryOffset + 24, entries[i]->GetBlockCount());
+		unsigned char *entryData = data + PitData::kHeaderDataSize + i * PitEntry::kDataSize;
 
-		PitData::PackInteger(data, entryOffset + 28, entries[i]->GetFileOffset());
-		PitData::PackInteger(data, entryOffset + 32, entries[i]->GetFileSize());
+		EntryLayout::Pack(entryData, entries[i]->GetBinaryType(), entries[i]->GetDeviceType(), entries[i]->GetIdentifier(),
+			entries[i]->GetAttributes(), entries[i]->GetUpdateAttributes(), entries[i]->GetBlockSizeOrOffset(),
+			entries[i]->GetBlockCount(), entries[i]->GetFileOffset(), entries[i]->GetFileSize());
 
-		memcpy(data + entryOffset + 36, entries[i]->GetPartitionName(), PitEntry::kPartitionNameMaxLength);
-		memcpy(data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength, entries[i]->GetFlashFilename(), PitEntry::kFlashFilenameMaxLength);
-		memcpy(data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength,
+		memcpy(entryData + EntryLayout::kEnd, entries[i]->GetPartitionName(), PitEntry::kPartitionNameMaxLength);
+		memcpy(entryData + EntryLayout::kEnd + PitEntry::kPartitionNameMaxLength, entries[i]->GetFlashFilename(), PitEntry::kFlashFilenameMaxLength);
+		memcpy(entryData + EntryLayout::kEnd + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength,
 			entries[i]->GetFotaFilename(), PitEntry::kFotaFilenameMaxLength);
 	}
 }
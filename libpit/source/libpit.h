@@ -25,7 +25,7 @@
 #pragma warning(disable : 4996)
 #endif
 
-#if (!(defined _MSC_VER) || (_MSC_VER < 1700))
+#if ((defined _MSC_VER) && (_MSC_VER < 1700)) || (!(defined _MSC_VER) && (__cplusplus < 201103L))
 
 #ifndef nullptr
 #define nullptr 0
@@ -38,6 +38,9 @@
 #include <string>
 #include <vector>
 
+// libpit
+#include "PackedLayout.h"
+
 namespace libpit
 {
 	class PitEntry
@@ -278,57 +281,16 @@ namespace libpit
 			// Entries start at 0x1C
 			std::vector<PitEntry *> entries;
 
-			static int UnpackInteger(const unsigned char *data, unsigned int offset)
-			{
-#ifdef WORDS_BIGENDIAN
-				int value = (data[offset] << 24) | (data[offset + 1] << 16) |
-					(data[offset + 2] << 8) | data[offset + 3];
-#else
-				// Flip endianness
-				int value = data[offset] | (data[offset + 1] << 8) |
-					(data[offset + 2] << 16) | (data[offset + 3] << 24);
-#endif
-				return (value);
-			}
+			typedef PackedLayout<0, unsigned int, unsigned int, unsigned int, unsigned int, unsigned short, unsigned short,
+				unsigned short, unsigned short, unsigned short, unsigned short> HeaderLayout;
 
-			static int UnpackShort(const unsigned char *data, unsigned int offset)
-			{
-#ifdef WORDS_BIGENDIAN
-				short value = (data[offset] << 8) | data[offset + 1];
-#else
-				// Flip endianness
-				short value = data[offset] | (data[offset + 1] << 8);
-#endif
-				return (value);
-			}
-
-			static void PackInteger(unsigned char *data, unsigned int offset, unsigned int value)
-			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF000000) >> 24;
-				data[offset + 1] = (value & 0x00FF0000) >> 16;
-				data[offset + 2] = (value & 0x0000FF00) >> 8;
-				data[offset + 3] = value & 0x000000FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x000000FF;
-				data[offset + 1] = (value & 0x0000FF00) >> 8;
-				data[offset + 2] = (value & 0x00FF0000) >> 16;
-				data[offset + 3] = (value & 0xFF000000) >> 24;
-#endif
-			}
+			// Binary type through to file size, the entry's names follow.
+			typedef PackedLayout<0, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int,
+				unsigned int, unsigned int, unsigned int> EntryLayout;
 
-			static void PackShort(unsigned char *data, unsigned int offset, unsigned short value)
-			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF00) >> 8;
-				data[offset + 1] = value & 0x00FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x00FF;
-				data[offset + 1] = (value & 0xFF00) >> 8;
-#endif
-			}
+			static_assert(HeaderLayout::kEnd == kHeaderDataSize, "PIT header layout does not match its size");
+			static_assert(EntryLayout::kEnd + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength
+				+ PitEntry::kFotaFilenameMaxLength == PitEntry::kDataSize, "PIT entry layout does not match its size");
 
 		public:
 